@@ -3,6 +3,7 @@
 
 #include <cstddef> // size_t
 #include <vector>  // vector
+#include <utility> // pair
 #include "../../Logger/include/ILogger.h"
 #include "../../Vector/include/IVector.h"
 #include "../../Util/ReturnCode.h"
@@ -30,6 +31,9 @@ public:
     static ICompact* _union(ICompact const* comp1, ICompact const* comp2, double tolerance, ILogger* logger = nullptr);
     static ICompact* convex(ICompact const* comp1, ICompact const* comp2, double tolerance, ILogger* logger = nullptr);
     static ICompact* intersection(ICompact const* comp1, ICompact const* comp2, double tolerance, ILogger* logger = nullptr);
+    // numbers of every two compacts that intersect, first < second, in ascending order.
+    // sweep and prune over the bounds, far cheaper than intersects for every pair. pairs are empty after an error
+    static ReturnCode findOverlaps(std::vector<ICompact const*> const& comps, std::vector<std::pair<size_t, size_t>>& pairs, ILogger* logger = nullptr);
 
     virtual Iterator* begin(IVector const* step) = 0;
     virtual Iterator* end(IVector const* step)   = 0;
@@ -37,7 +41,15 @@ public:
     virtual ICompact* clone()                                         const = 0;
     virtual IVector* getBegin()                                       const = 0;
     virtual IVector* getEnd()                                         const = 0;
+    // read-only corners owned by the compact, valid while it exists; nothing is copied
+    virtual IVector const* getBeginView()                             const = 0;
+    virtual IVector const* getEndView()                               const = 0;
     virtual ReturnCode contains(IVector const* vec, bool& result)     const = 0;
+    // batch tests of count row-major points of the compact's dimension: bit i % 64 of mask[i / 64]
+    // is set when point i lies in the compact, the mask takes (count + 63) / 64 words
+    virtual ReturnCode contains(double const* points, size_t count, unsigned long long* mask) const = 0;
+    // numbers of the points lying in the compact, in ascending order
+    virtual ReturnCode contains(double const* points, size_t count, std::vector<size_t>& inds) const = 0;
     virtual ReturnCode isSubset(ICompact const* comp, bool& result)   const = 0;
     virtual ReturnCode intersects(ICompact const* comp, bool& result) const = 0;
     virtual size_t getDim()                                           const = 0;
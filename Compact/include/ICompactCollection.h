@@ -0,0 +1,52 @@
+#ifndef ICOMPACT_COLLECTION_H
+#define ICOMPACT_COLLECTION_H
+
+#include <cstddef> // size_t
+#include <vector>  // vector
+#include <utility> // pair
+#include "../../Logger/include/ILogger.h"
+#include "../../Vector/include/IVector.h"
+#include "../../Util/ReturnCode.h"
+#include "../../Util/Export.h"
+#include "ICompact.h"
+
+// union of many axis-aligned boxes of one dimension, indexed by an R-tree.
+// the boxes are kept as added, they may overlap, and no union of them is ever refused.
+// queries reuse buffers of the collection, one collection is not to be queried by several threads at once
+class DECLSPEC ICompactCollection {
+public:
+    // parts of boxes thinner than tolerance are ignored by covers, as ICompact refuses such boxes
+    static ICompactCollection* createCollection(size_t dim, double tolerance, ILogger* logger = nullptr);
+    // boxes of both operands, nothing is merged or lost
+    static ICompactCollection* _union(ICompactCollection const* coll1, ICompactCollection const* coll2, double tolerance, ILogger* logger = nullptr);
+    static ICompactCollection* _union(ICompact const* comp1, ICompact const* comp2, double tolerance, ILogger* logger = nullptr);
+
+    // the bounds of the compact are copied
+    virtual ReturnCode add(ICompact const* comp) = 0;
+    virtual ReturnCode addAll(ICompactCollection const* other) = 0;
+
+    virtual ICompactCollection* clone()                               const = 0;
+    virtual ReturnCode get(ICompact*& dst, size_t ind)                const = 0;
+    // the point lies in some box
+    virtual ReturnCode contains(IVector const* vec, bool& result)     const = 0;
+    // some box meets the compact
+    virtual ReturnCode intersects(ICompact const* comp, bool& result) const = 0;
+    // every box lies in the compact
+    virtual ReturnCode isSubset(ICompact const* comp, bool& result)   const = 0;
+    // the compact lies in the union of the boxes, though maybe in no single one of them
+    virtual ReturnCode covers(ICompact const* comp, bool& result)     const = 0;
+    // numbers of every two boxes that meet, first < second, in ascending order, empty after an error
+    virtual ReturnCode findOverlaps(std::vector<std::pair<size_t, size_t>>& pairs) const = 0;
+    virtual size_t getDim()                                           const = 0;
+    // number of boxes
+    virtual size_t getCount()                                         const = 0;
+
+    ICompactCollection() = default;
+    virtual ~ICompactCollection() = 0;
+
+private:
+    ICompactCollection(ICompactCollection const&)            = delete;
+    ICompactCollection& operator=(ICompactCollection const&) = delete;
+};
+
+#endif /* ICOMPACT_COLLECTION_H */
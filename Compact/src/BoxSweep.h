@@ -0,0 +1,119 @@
+#ifndef BOX_SWEEP_H
+#define BOX_SWEEP_H
+
+#include <cstddef>  // size_t
+#include <vector>   // vector
+#include <utility>  // pair
+#include <algorithm>// sort, upper_bound, min, max
+
+namespace {
+    /* declaration */
+    // broad phase over many closed boxes: the bounds are kept one array per coordinate, boxes are
+    // sorted by the lower bound along the axis where they spread most relative to their size,
+    // and every box is checked against the following ones until their lower bounds pass its upper one
+    class BoxSweep {
+    public:
+        BoxSweep() = default;
+
+        // reset and findOverlaps throw bad_alloc, callers report it as RC_NO_MEM
+        void reset(size_t dim, size_t count);
+        void setBox(size_t ind, double const* lower, double const* upper);
+        // pairs of meeting boxes, first < second, in ascending order
+        void findOverlaps(std::vector<std::pair<size_t, size_t>>& pairs) const;
+
+    private:
+        size_t chooseAxis() const;
+
+        size_t m_dim {0};
+        size_t m_count {0};
+        // coordinate i of box j at [i * m_count + j]
+        std::vector<double> m_lower;
+        std::vector<double> m_upper;
+    };
+}
+
+/* implementation */
+void BoxSweep::reset(size_t dim, size_t count) {
+    m_dim = dim;
+    m_count = count;
+    m_lower.resize(dim * count);
+    m_upper.resize(dim * count);
+}
+
+void BoxSweep::setBox(size_t ind, double const* lower, double const* upper) {
+    for (size_t i = 0; i < m_dim; ++i) {
+        m_lower[i * m_count + ind] = lower[i];
+        m_upper[i * m_count + ind] = upper[i];
+    }
+}
+
+// the spread of the centers over the mean width estimates how many boxes a box meets along the axis
+size_t BoxSweep::chooseAxis() const {
+    size_t best = 0;
+    double bestRatio = -1.0;
+    for (size_t i = 0; i < m_dim; ++i) {
+        double const* lower = m_lower.data() + i * m_count;
+        double const* upper = m_upper.data() + i * m_count;
+        double low = lower[0] + upper[0];
+        double high = low;
+        double width = 0.0;
+        for (size_t j = 0; j < m_count; ++j) {
+            low = std::min(low, lower[j] + upper[j]);
+            high = std::max(high, lower[j] + upper[j]);
+            width += upper[j] - lower[j];
+        }
+        double ratio = width > 0.0 ? (high - low) * (double)m_count / width : high - low;
+        if (ratio > bestRatio) {
+            best = i;
+            bestRatio = ratio;
+        }
+    }
+    return best;
+}
+
+void BoxSweep::findOverlaps(std::vector<std::pair<size_t, size_t>>& pairs) const {
+    pairs.clear();
+    if (m_count < 2 || m_dim == 0) {
+        return;
+    }
+
+    size_t axis = chooseAxis();
+    std::vector<size_t> order(m_count);
+    for (size_t j = 0; j < m_count; ++j) {
+        order[j] = j;
+    }
+    double const* axisLower = m_lower.data() + axis * m_count;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return axisLower[a] < axisLower[b];
+    });
+
+    // bounds in sweep order with the sweep axis first, the inner loop reads them contiguously
+    std::vector<double> lower(m_dim * m_count);
+    std::vector<double> upper(m_dim * m_count);
+    for (size_t i = 0; i < m_dim; ++i) {
+        size_t from = (i == 0 ? axis : (i <= axis ? i - 1 : i)) * m_count;
+        for (size_t j = 0; j < m_count; ++j) {
+            lower[i * m_count + j] = m_lower[from + order[j]];
+            upper[i * m_count + j] = m_upper[from + order[j]];
+        }
+    }
+
+    // candidates of a box are the run of boxes starting before its upper bound along the axis,
+    // the other axes are tested without branches over that run
+    for (size_t a = 0; a + 1 < m_count; ++a) {
+        size_t last = std::upper_bound(lower.begin() + a + 1, lower.begin() + m_count, upper[a]) - lower.begin();
+        for (size_t b = a + 1; b < last; ++b) {
+            bool meet = true;
+            for (size_t i = 1; i < m_dim; ++i) {
+                meet &= (lower[i * m_count + b] <= upper[i * m_count + a]) &
+                        (lower[i * m_count + a] <= upper[i * m_count + b]);
+            }
+            if (meet) {
+                pairs.push_back(std::make_pair(std::min(order[a], order[b]), std::max(order[a], order[b])));
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+}
+
+#endif /* BOX_SWEEP_H */
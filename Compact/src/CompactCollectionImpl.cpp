@@ -0,0 +1,562 @@
+#include "../include/ICompactCollection.h"
+#include "BoxSweep.h"
+#include <cmath>    // pow, ceil
+#include <new>      // nothrow, bad_alloc
+#include <vector>   // vector
+#include <algorithm>// sort, min, max
+
+namespace {
+    /* declaration */
+    class CompactCollectionImpl : public ICompactCollection {
+    private:
+        // leaves hold boxes m_order[first, first + count), inner nodes hold nodes m_children[first, first + count)
+        struct Node {
+            size_t first;
+            size_t count;
+            bool leaf;
+        };
+
+        size_t m_dim {0};
+        double m_tolerance {0.0};
+        size_t m_count {0};
+        // every box and the bounding box of them all are stored as the lower corner followed by the upper one
+        std::vector<double> m_boxes;
+        std::vector<double> m_bounds;
+        // R-tree over the first m_indexed boxes, packed sort-tile-recursive. later boxes are scanned
+        // until they outnumber a fraction of the indexed ones, then the next query rebuilds the tree
+        mutable std::vector<Node> m_nodes;
+        mutable std::vector<double> m_nodeBounds;
+        mutable std::vector<size_t> m_order;
+        mutable std::vector<size_t> m_children;
+        mutable size_t m_root {0};
+        mutable size_t m_indexed {0};
+        mutable std::vector<size_t> m_stack;
+        mutable std::vector<double> m_query;
+        ILogger* m_logger {nullptr};
+
+        double const* box(size_t ind) const;
+        double const* nodeBox(size_t node) const;
+        ReturnCode append(double const* bounds);
+        void buildIndex() const;
+        void buildTree() const;
+        template<class Center>
+        void tileSort(size_t* first, size_t* last, size_t axis, Center center) const;
+        void addNode(size_t first, size_t count, bool leaf, std::vector<size_t>& level) const;
+        // the piece splitting behind covers, throws bad_alloc when the pieces do not fit
+        bool coveredBy(ICompact const* comp) const;
+        // calls action(ind) for every box meeting the query box until it returns true
+        template<class Action>
+        bool visit(double const* query, Action action) const;
+
+    public:
+        ReturnCode add(ICompact const* comp)                      override;
+        ReturnCode addAll(ICompactCollection const* other)        override;
+
+        ICompactCollection* clone()                               const override;
+        ReturnCode get(ICompact*& dst, size_t ind)                const override;
+        ReturnCode contains(IVector const* vec, bool& result)     const override;
+        ReturnCode intersects(ICompact const* comp, bool& result) const override;
+        ReturnCode isSubset(ICompact const* comp, bool& result)   const override;
+        ReturnCode covers(ICompact const* comp, bool& result)     const override;
+        ReturnCode findOverlaps(std::vector<std::pair<size_t, size_t>>& pairs) const override;
+        size_t getDim()                                           const override;
+        size_t getCount()                                         const override;
+
+        // nullptr when there is no memory for the collection or its query buffer
+        static CompactCollectionImpl* create(size_t dim, double tolerance);
+
+        CompactCollectionImpl(size_t dim, double tolerance);
+        ~CompactCollectionImpl();
+    };
+}
+
+/* implementation */
+static size_t const RTREE_NODE_CAPACITY = 16;
+
+// closed boxes, stored as the lower corner followed by the upper one
+static inline bool boxesMeet(double const* a, double const* b, size_t dim) {
+    for (size_t i = 0; i < dim; ++i) {
+        if (a[i] > b[dim + i] || b[i] > a[dim + i])
+            return false;
+    }
+    return true;
+}
+
+static inline bool boxInside(double const* inner, double const* outer, size_t dim) {
+    for (size_t i = 0; i < dim; ++i) {
+        if (inner[i] < outer[i] || inner[dim + i] > outer[dim + i])
+            return false;
+    }
+    return true;
+}
+
+static inline void growBox(double* bounds, double const* other, size_t dim) {
+    for (size_t i = 0; i < dim; ++i) {
+        bounds[i] = std::min(bounds[i], other[i]);
+        bounds[dim + i] = std::max(bounds[dim + i], other[dim + i]);
+    }
+}
+
+CompactCollectionImpl::CompactCollectionImpl(size_t dim, double tolerance) :
+    m_dim(dim),
+    m_tolerance(tolerance) {
+    m_logger = ILogger::createLogger(this);
+    }
+
+CompactCollectionImpl::~CompactCollectionImpl() {
+    if (m_logger != nullptr) {
+        m_logger->releaseLogger(this);
+    }
+}
+
+CompactCollectionImpl* CompactCollectionImpl::create(size_t dim, double tolerance) {
+    CompactCollectionImpl* collection = new(std::nothrow) CompactCollectionImpl(dim, tolerance);
+    if (collection == nullptr) {
+        return nullptr;
+    }
+
+    try {
+        collection->m_query.resize(2 * dim);
+    }
+    catch (std::bad_alloc const&) {
+        delete collection;
+        return nullptr;
+    }
+    return collection;
+}
+
+double const* CompactCollectionImpl::box(size_t ind) const {
+    return m_boxes.data() + 2 * m_dim * ind;
+}
+
+double const* CompactCollectionImpl::nodeBox(size_t node) const {
+    return m_nodeBounds.data() + 2 * m_dim * node;
+}
+
+// boxes thinner than the tolerance are refused, as ICompact::createCompact does
+ReturnCode CompactCollectionImpl::append(double const* bounds) {
+    for (size_t i = 0; i < m_dim; ++i) {
+        if (bounds[m_dim + i] - bounds[i] < m_tolerance) {
+            LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+            return ReturnCode::RC_INVALID_PARAMS;
+        }
+    }
+
+    try {
+        m_boxes.insert(m_boxes.end(), bounds, bounds + 2 * m_dim);
+        if (m_count == 0) {
+            m_bounds.assign(bounds, bounds + 2 * m_dim);
+        }
+    }
+    catch (std::bad_alloc const&) {
+        m_boxes.resize(2 * m_dim * m_count);
+        LOG(m_logger, ReturnCode::RC_NO_MEM);
+        return ReturnCode::RC_NO_MEM;
+    }
+    if (m_count != 0) {
+        growBox(m_bounds.data(), bounds, m_dim);
+    }
+    ++m_count;
+    return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode CompactCollectionImpl::add(ICompact const* comp) {
+    if (comp == nullptr) {
+        LOG(m_logger, ReturnCode::RC_NULL_PTR);
+        return ReturnCode::RC_NULL_PTR;
+    }
+
+    if (comp->getDim() != m_dim) {
+        LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+        return ReturnCode::RC_WRONG_DIM;
+    }
+
+    comp->getBeginView()->getCoords(0, m_dim, m_query.data());
+    comp->getEndView()->getCoords(0, m_dim, m_query.data() + m_dim);
+    return append(m_query.data());
+}
+
+// every box is checked before the first one is added, so a failure adds nothing
+ReturnCode CompactCollectionImpl::addAll(ICompactCollection const* other) {
+    if (other == nullptr) {
+        LOG(m_logger, ReturnCode::RC_NULL_PTR);
+        return ReturnCode::RC_NULL_PTR;
+    }
+
+    if (other->getDim() != m_dim) {
+        LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+        return ReturnCode::RC_WRONG_DIM;
+    }
+
+    CompactCollectionImpl const* impl = dynamic_cast<CompactCollectionImpl const*>(other);
+    if (impl == nullptr) {
+        LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+        return ReturnCode::RC_INVALID_PARAMS;
+    }
+
+    size_t count = impl->m_count;
+    for (size_t j = 0; j < count; ++j) {
+        for (size_t i = 0; i < m_dim; ++i) {
+            if (impl->box(j)[m_dim + i] - impl->box(j)[i] < m_tolerance) {
+                LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+                return ReturnCode::RC_INVALID_PARAMS;
+            }
+        }
+    }
+    // boxes of this very collection are copied before they are appended to it. the room is
+    // taken up front, so appending cannot run out of memory halfway
+    std::vector<double> copy;
+    double const* boxes = impl->m_boxes.data();
+    try {
+        if (impl == this) {
+            copy = m_boxes;
+            boxes = copy.data();
+        }
+        m_boxes.reserve(m_boxes.size() + 2 * m_dim * count);
+        m_bounds.reserve(2 * m_dim);
+    }
+    catch (std::bad_alloc const&) {
+        LOG(m_logger, ReturnCode::RC_NO_MEM);
+        return ReturnCode::RC_NO_MEM;
+    }
+    for (size_t j = 0; j < count; ++j) {
+        append(boxes + 2 * m_dim * j);
+    }
+    return ReturnCode::RC_SUCCESS;
+}
+
+// sorts items by the centers along the axis and cuts them into slabs of whole nodes, every slab
+// is sorted along the next axis in turn. consecutive runs of RTREE_NODE_CAPACITY items form nodes
+template<class Center>
+void CompactCollectionImpl::tileSort(size_t* first, size_t* last, size_t axis, Center center) const {
+    std::sort(first, last, [&](size_t a, size_t b) {
+        return center(a, axis) < center(b, axis);
+    });
+
+    size_t count = last - first;
+    if (axis + 1 >= m_dim || count <= RTREE_NODE_CAPACITY) {
+        return;
+    }
+
+    size_t nodes = (count + RTREE_NODE_CAPACITY - 1) / RTREE_NODE_CAPACITY;
+    size_t slabs = (size_t)std::ceil(std::pow((double)nodes, 1.0 / (double)(m_dim - axis)));
+    size_t slabSize = RTREE_NODE_CAPACITY * ((nodes + slabs - 1) / slabs);
+    for (size_t* slab = first; slab < last; slab += std::min(slabSize, (size_t)(last - slab))) {
+        tileSort(slab, slab + std::min(slabSize, (size_t)(last - slab)), axis + 1, center);
+    }
+}
+
+void CompactCollectionImpl::addNode(size_t first, size_t count, bool leaf, std::vector<size_t>& level) const {
+    std::vector<size_t> const& items = leaf ? m_order : m_children;
+    double const* start = leaf ? box(items[first]) : nodeBox(items[first]);
+    std::vector<double> bounds(start, start + 2 * m_dim);
+    for (size_t i = 1; i < count; ++i) {
+        growBox(bounds.data(), leaf ? box(items[first + i]) : nodeBox(items[first + i]), m_dim);
+    }
+
+    level.push_back(m_nodes.size());
+    m_nodes.push_back(Node{first, count, leaf});
+    m_nodeBounds.insert(m_nodeBounds.end(), bounds.begin(), bounds.end());
+}
+
+// a failed build leaves no tree, every box is scanned until the next attempt
+void CompactCollectionImpl::buildIndex() const {
+    m_nodes.clear();
+    m_nodeBounds.clear();
+    m_children.clear();
+    m_indexed = 0;
+    if (m_count == 0) {
+        return;
+    }
+
+    try {
+        buildTree();
+    }
+    catch (std::bad_alloc const&) {
+        m_nodes.clear();
+        m_nodeBounds.clear();
+        m_children.clear();
+        LOG(m_logger, ReturnCode::RC_NO_MEM);
+        return;
+    }
+    m_indexed = m_count;
+}
+
+// the traversal stack is reserved here as well, it never holds more entries than there are nodes
+void CompactCollectionImpl::buildTree() const {
+    m_order.resize(m_count);
+    for (size_t i = 0; i < m_count; ++i) {
+        m_order[i] = i;
+    }
+    // doubled centers order the items as well
+    tileSort(m_order.data(), m_order.data() + m_count, 0, [&](size_t ind, size_t axis) {
+        return box(ind)[axis] + box(ind)[m_dim + axis];
+    });
+    std::vector<size_t> level;
+    for (size_t first = 0; first < m_count; first += RTREE_NODE_CAPACITY) {
+        addNode(first, std::min(RTREE_NODE_CAPACITY, m_count - first), true, level);
+    }
+
+    while (level.size() > 1) {
+        tileSort(level.data(), level.data() + level.size(), 0, [&](size_t node, size_t axis) {
+            return nodeBox(node)[axis] + nodeBox(node)[m_dim + axis];
+        });
+        size_t first = m_children.size();
+        m_children.insert(m_children.end(), level.begin(), level.end());
+        std::vector<size_t> parents;
+        for (size_t i = 0; i < level.size(); i += RTREE_NODE_CAPACITY) {
+            addNode(first + i, std::min(RTREE_NODE_CAPACITY, level.size() - i), false, parents);
+        }
+        level.swap(parents);
+    }
+    m_root = level[0];
+    m_stack.reserve(m_nodes.size());
+}
+
+template<class Action>
+bool CompactCollectionImpl::visit(double const* query, Action action) const {
+    // rebuilding after every eighth of the boxes keeps the scanned tail short and the cost amortized
+    if (m_count - m_indexed > m_indexed / 8 + RTREE_NODE_CAPACITY) {
+        buildIndex();
+    }
+
+    if (!m_nodes.empty()) {
+        m_stack.assign(1, m_root);
+        while (!m_stack.empty()) {
+            size_t ind = m_stack.back();
+            m_stack.pop_back();
+            if (!boxesMeet(nodeBox(ind), query, m_dim)) {
+                continue;
+            }
+            Node node = m_nodes[ind];
+            for (size_t i = node.first; i < node.first + node.count; ++i) {
+                if (!node.leaf) {
+                    m_stack.push_back(m_children[i]);
+                }
+                else if (boxesMeet(box(m_order[i]), query, m_dim) && action(m_order[i])) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    for (size_t i = m_indexed; i < m_count; ++i) {
+        if (boxesMeet(box(i), query, m_dim) && action(i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ICompactCollection* CompactCollectionImpl::clone() const {
+    CompactCollectionImpl* copy = create(m_dim, m_tolerance);
+    if (copy == nullptr) {
+        LOG(m_logger, ReturnCode::RC_NO_MEM);
+        return nullptr;
+    }
+
+    try {
+        copy->m_boxes = m_boxes;
+        copy->m_bounds = m_bounds;
+    }
+    catch (std::bad_alloc const&) {
+        delete copy;
+        LOG(m_logger, ReturnCode::RC_NO_MEM);
+        return nullptr;
+    }
+    copy->m_count = m_count;
+    return copy;
+}
+
+ReturnCode CompactCollectionImpl::get(ICompact*& dst, size_t ind) const {
+    dst = nullptr;
+    if (ind >= m_count) {
+        LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+        return ReturnCode::RC_OUT_OF_BOUNDS;
+    }
+
+    std::vector<double> bounds(box(ind), box(ind) + 2 * m_dim);
+    IVector* begin = IVector::createVector(m_dim, bounds.data(), m_logger);
+    IVector* end   = IVector::createVector(m_dim, bounds.data() + m_dim, m_logger);
+    if (begin != nullptr && end != nullptr) {
+        dst = ICompact::createCompact(begin, end, m_tolerance, m_logger);
+    }
+    delete begin;
+    delete end;
+
+    return dst != nullptr ? ReturnCode::RC_SUCCESS : ReturnCode::RC_NO_MEM;
+}
+
+ReturnCode CompactCollectionImpl::contains(IVector const* vec, bool& result) const {
+    result = false;
+    if (vec == nullptr) {
+        LOG(m_logger, ReturnCode::RC_NULL_PTR);
+        return ReturnCode::RC_NULL_PTR;
+    }
+
+    if (vec->getDim() != m_dim) {
+        LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+        return ReturnCode::RC_WRONG_DIM;
+    }
+
+    // the point is a box with equal corners
+    vec->getCoords(0, m_dim, m_query.data());
+    vec->getCoords(0, m_dim, m_query.data() + m_dim);
+    result = visit(m_query.data(), [](size_t) {
+        return true;
+    });
+    return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode CompactCollectionImpl::intersects(ICompact const* comp, bool& result) const {
+    result = false;
+    if (comp == nullptr) {
+        LOG(m_logger, ReturnCode::RC_NULL_PTR);
+        return ReturnCode::RC_NULL_PTR;
+    }
+
+    if (comp->getDim() != m_dim) {
+        LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+        return ReturnCode::RC_WRONG_DIM;
+    }
+
+    comp->getBeginView()->getCoords(0, m_dim, m_query.data());
+    comp->getEndView()->getCoords(0, m_dim, m_query.data() + m_dim);
+    result = visit(m_query.data(), [](size_t) {
+        return true;
+    });
+    return ReturnCode::RC_SUCCESS;
+}
+
+// the bounding box of all boxes decides, an empty collection is a subset of anything
+ReturnCode CompactCollectionImpl::isSubset(ICompact const* comp, bool& result) const {
+    result = false;
+    if (comp == nullptr) {
+        LOG(m_logger, ReturnCode::RC_NULL_PTR);
+        return ReturnCode::RC_NULL_PTR;
+    }
+
+    if (comp->getDim() != m_dim) {
+        LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+        return ReturnCode::RC_WRONG_DIM;
+    }
+
+    comp->getBeginView()->getCoords(0, m_dim, m_query.data());
+    comp->getEndView()->getCoords(0, m_dim, m_query.data() + m_dim);
+    result = m_count == 0 || boxInside(m_bounds.data(), m_query.data(), m_dim);
+    return ReturnCode::RC_SUCCESS;
+}
+
+// the uncovered part of the compact is kept as a list of boxes. a box overlapping a piece with
+// positive volume is cut out of it, leaving at most two slabs per axis, and it only touches them
+// afterwards, so no box cuts a piece twice. a piece no box overlaps is uncovered unless it is thinner than the tolerance
+ReturnCode CompactCollectionImpl::covers(ICompact const* comp, bool& result) const {
+    result = false;
+    if (comp == nullptr) {
+        LOG(m_logger, ReturnCode::RC_NULL_PTR);
+        return ReturnCode::RC_NULL_PTR;
+    }
+
+    if (comp->getDim() != m_dim) {
+        LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+        return ReturnCode::RC_WRONG_DIM;
+    }
+
+    try {
+        result = coveredBy(comp);
+    }
+    catch (std::bad_alloc const&) {
+        result = false;
+        LOG(m_logger, ReturnCode::RC_NO_MEM);
+        return ReturnCode::RC_NO_MEM;
+    }
+    return ReturnCode::RC_SUCCESS;
+}
+
+bool CompactCollectionImpl::coveredBy(ICompact const* comp) const {
+    size_t const size = 2 * m_dim;
+    std::vector<double> pieces(size);
+    comp->getBeginView()->getCoords(0, m_dim, pieces.data());
+    comp->getEndView()->getCoords(0, m_dim, pieces.data() + m_dim);
+    std::vector<double> piece(size);
+    while (!pieces.empty()) {
+        piece.assign(pieces.end() - size, pieces.end());
+        pieces.resize(pieces.size() - size);
+
+        bool thin = false;
+        for (size_t i = 0; i < m_dim && !thin; ++i) {
+            thin = piece[m_dim + i] - piece[i] < m_tolerance || piece[m_dim + i] <= piece[i];
+        }
+        if (thin) {
+            continue;
+        }
+
+        // a box holding the whole piece ends the search, otherwise the one with the largest overlap cuts it
+        bool inside = false;
+        size_t cutter = m_count;
+        double cutterVolume = 0.0;
+        visit(piece.data(), [&](size_t ind) {
+            double const* b = box(ind);
+            if (boxInside(piece.data(), b, m_dim)) {
+                inside = true;
+                return true;
+            }
+            double volume = 1.0;
+            for (size_t i = 0; i < m_dim && volume > 0.0; ++i) {
+                volume *= std::min(piece[m_dim + i], b[m_dim + i]) - std::max(piece[i], b[i]);
+            }
+            if (volume > cutterVolume) {
+                cutter = ind;
+                cutterVolume = volume;
+            }
+            return false;
+        });
+        if (inside) {
+            continue;
+        }
+        if (cutter == m_count) {
+            return false;
+        }
+
+        double const* b = box(cutter);
+        for (size_t i = 0; i < m_dim; ++i) {
+            if (piece[i] < b[i]) {
+                pieces.insert(pieces.end(), piece.begin(), piece.end());
+                pieces[pieces.size() - m_dim + i] = b[i];
+                piece[i] = b[i];
+            }
+            if (piece[m_dim + i] > b[m_dim + i]) {
+                pieces.insert(pieces.end(), piece.begin(), piece.end());
+                pieces[pieces.size() - size + i] = b[m_dim + i];
+                piece[m_dim + i] = b[m_dim + i];
+            }
+        }
+    }
+
+    return true;
+}
+
+ReturnCode CompactCollectionImpl::findOverlaps(std::vector<std::pair<size_t, size_t>>& pairs) const {
+    try {
+        BoxSweep sweep;
+        sweep.reset(m_dim, m_count);
+        for (size_t j = 0; j < m_count; ++j) {
+            sweep.setBox(j, box(j), box(j) + m_dim);
+        }
+        sweep.findOverlaps(pairs);
+    }
+    catch (std::bad_alloc const&) {
+        pairs.clear();
+        LOG(m_logger, ReturnCode::RC_NO_MEM);
+        return ReturnCode::RC_NO_MEM;
+    }
+    return ReturnCode::RC_SUCCESS;
+}
+
+size_t CompactCollectionImpl::getDim() const {
+    return m_dim;
+}
+
+size_t CompactCollectionImpl::getCount() const {
+    return m_count;
+}
@@ -1,8 +1,8 @@
 #include "../include/ICompact.h"
 #include <cmath>    // fabs (C++11)
-#include <new>		// nothrow
+#include <new>		// nothrow, bad_alloc
 #include <algorithm>// min, max
-#include <assert.h> // assert
+#include <vector>   // vector
 
 namespace {
     /* declaration */
@@ -11,9 +11,13 @@ namespace {
         size_t m_dim {0};
         IVector* m_begin {nullptr};
         IVector* m_end {nullptr};
+        // lower corner followed by the upper one, read without virtual calls
+        std::vector<double> m_bounds;
         ILogger* m_logger {nullptr};
         double const m_tolerance;
 
+        void containsBlock(double const* points, size_t count, unsigned long long& word) const;
+
     public:
         class IteratorImpl : public ICompact::Iterator {
         private:
@@ -42,12 +46,17 @@ namespace {
         ICompact* clone()                                         const override;
         IVector* getBegin()                                       const override;
         IVector* getEnd()                                         const override;
+        IVector const* getBeginView()                             const override;
+        IVector const* getEndView()                               const override;
         ReturnCode contains(IVector const* vec, bool& result)     const override;
+        ReturnCode contains(double const* points, size_t count, unsigned long long* mask) const override;
+        ReturnCode contains(double const* points, size_t count, std::vector<size_t>& inds) const override;
         ReturnCode isSubset(ICompact const* comp, bool& result)   const override;
         ReturnCode intersects(ICompact const* comp, bool& result) const override;
         size_t getDim() const override;
 
-        CompactImpl(IVector const* begin, IVector const* end, double tolerance);
+        // bounds hold the lower corner followed by the upper one, the corner vectors are null when out of memory
+        CompactImpl(size_t dim, double const* bounds, double tolerance);
         ~CompactImpl();
     };
 }
@@ -256,13 +265,20 @@ ICompact::Iterator* CompactImpl::end(IVector const* temp) {
     return createIterator(m_begin, m_end, temp, false, m_logger);
 }
 
-CompactImpl::CompactImpl(IVector const* begin, IVector const* end, double tolerance) :
-    m_dim(begin->getDim()),
-    m_begin(begin->clone()),
-    m_end(end->clone()),
+CompactImpl::CompactImpl(size_t dim, double const* bounds, double tolerance) :
+    m_dim(dim),
     m_tolerance(tolerance) {
     m_logger = ILogger::createLogger(this);
+    // new(std::nothrow) does not cover the constructor, on failure the corners stay null for the factory to see
+    try {
+        m_bounds.assign(bounds, bounds + 2 * dim);
+    }
+    catch (std::bad_alloc const&) {
+        return;
     }
+    m_begin = IVector::createVector(m_dim, m_bounds.data(), m_logger);
+    m_end   = IVector::createVector(m_dim, m_bounds.data() + m_dim, m_logger);
+}
 
 CompactImpl::~CompactImpl() {
     m_dim = 0;
@@ -288,6 +304,14 @@ IVector* CompactImpl::getEnd() const {
     return m_end->clone();
 }
 
+IVector const* CompactImpl::getBeginView() const {
+    return m_begin;
+}
+
+IVector const* CompactImpl::getEndView() const {
+    return m_end;
+}
+
 ReturnCode CompactImpl::contains(IVector const* vec, bool& result) const {
     result = false;
     if (vec == nullptr) {
@@ -300,17 +324,92 @@ ReturnCode CompactImpl::contains(IVector const* vec, bool& result) const {
         return ReturnCode::RC_WRONG_DIM;
     }
 
+    double const* lower = m_bounds.data();
+    double const* upper = m_bounds.data() + m_dim;
     for (size_t i = 0; i < m_dim; ++i) {
-        if (vec->getCoord(i) < m_begin->getCoord(i) ||
-            vec->getCoord(i) > m_end->getCoord(i)) {
-                return ReturnCode::RC_SUCCESS;
-            }
+        double x = vec->getCoord(i);
+        if (x < lower[i] || x > upper[i]) {
+            return ReturnCode::RC_SUCCESS;
+        }
     }
 
     result = true;
     return ReturnCode::RC_SUCCESS;
 }
 
+// up to 64 points into one mask word. the loops carry no branches and the inner one runs across
+// points, so the compiler can vectorize it; comparisons match contains, nan coordinates are inside
+void CompactImpl::containsBlock(double const* points, size_t count, unsigned long long& word) const {
+    unsigned char inside[64];
+    for (size_t j = 0; j < count; ++j) {
+        inside[j] = 1;
+    }
+    for (size_t i = 0; i < m_dim; ++i) {
+        double const lower = m_bounds[i];
+        double const upper = m_bounds[m_dim + i];
+        double const* coords = points + i;
+        for (size_t j = 0; j < count; ++j) {
+            double x = coords[j * m_dim];
+            inside[j] &= (unsigned char)(!(x < lower) & !(x > upper));
+        }
+    }
+
+    word = 0;
+    for (size_t j = 0; j < count; ++j) {
+        word |= (unsigned long long)inside[j] << j;
+    }
+}
+
+ReturnCode CompactImpl::contains(double const* points, size_t count, unsigned long long* mask) const {
+    if (count == 0) {
+        return ReturnCode::RC_SUCCESS;
+    }
+
+    if (points == nullptr || mask == nullptr) {
+        LOG(m_logger, ReturnCode::RC_NULL_PTR);
+        return ReturnCode::RC_NULL_PTR;
+    }
+
+    for (size_t first = 0; first < count; first += 64) {
+        size_t block = count - first < 64 ? count - first : 64;
+        containsBlock(points + first * m_dim, block, mask[first / 64]);
+    }
+    return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode CompactImpl::contains(double const* points, size_t count, std::vector<size_t>& inds) const {
+    inds.clear();
+    if (count == 0) {
+        return ReturnCode::RC_SUCCESS;
+    }
+
+    if (points == nullptr) {
+        LOG(m_logger, ReturnCode::RC_NULL_PTR);
+        return ReturnCode::RC_NULL_PTR;
+    }
+
+    // every point may be inside, reserving up front keeps push_back from throwing out of the library
+    try {
+        inds.reserve(count);
+    }
+    catch (std::bad_alloc const&) {
+        LOG(m_logger, ReturnCode::RC_NO_MEM);
+        return ReturnCode::RC_NO_MEM;
+    }
+
+    for (size_t first = 0; first < count; first += 64) {
+        size_t block = count - first < 64 ? count - first : 64;
+        unsigned long long word = 0;
+        containsBlock(points + first * m_dim, block, word);
+        for (size_t j = 0; word != 0; ++j, word >>= 1) {
+            if (word & 1) {
+                inds.push_back(first + j);
+            }
+        }
+    }
+    return ReturnCode::RC_SUCCESS;
+}
+
 ReturnCode CompactImpl::isSubset(ICompact const* other, bool& result) const {
     if (other == nullptr) {
         LOG(m_logger, ReturnCode::RC_NULL_PTR);
@@ -351,25 +450,15 @@ ReturnCode CompactImpl::intersects(ICompact const* other, bool& result) const {
         return ReturnCode::RC_WRONG_DIM;
     }
 
-    IVector* otherBegin = other->getBegin();
-    IVector* otherEnd   = other->getEnd();
-    
-    // TODO: remove asserts
-    assert(otherBegin != nullptr);
-    assert(otherEnd != nullptr);
-    
-    bool has_intersection = true;
+    IVector const* otherBegin = other->getBeginView();
+    IVector const* otherEnd   = other->getEndView();
     for (size_t i = 0; i < m_dim; ++i) {
         if (std::max(m_begin->getCoord(i), otherBegin->getCoord(i)) > std::min(m_end->getCoord(i), otherEnd->getCoord(i))) {
-            has_intersection = false;
-            break;
+            return ReturnCode::RC_SUCCESS;
         }
     }
 
-    delete otherBegin;
-    delete otherEnd;
-
-    result = has_intersection;
+    result = true;
     return ReturnCode::RC_SUCCESS;
 }
 
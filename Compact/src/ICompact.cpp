@@ -1,9 +1,9 @@
 #include "../include/ICompact.h"
 #include "CompactImpl.cpp"
+#include "BoxSweep.h"
 #include <cmath>    // fabs (C++11), isnan
-#include <new>      // nothrow
-#include <algorithm>// min, max
-#include <assert.h> // assert
+#include <new>      // nothrow, bad_alloc
+#include <algorithm>// min, max, copy
 
 enum VectorComparison {
     VC_LESSER       = -1,
@@ -11,24 +11,56 @@ enum VectorComparison {
     VC_BIGGER       =  1
 };
 
-// left <comparison sign> right
-static VectorComparison compare(IVector const* const l, IVector const* const r, double tolerance) {
-    if (l == nullptr || r == nullptr ||
-        l->getDim() != r->getDim() ||
-        l->getDim() == 0)
-        return VectorComparison::VC_INCOMPARABLE;
+// box algebra of compacts up to this dimension keeps its coordinates on the stack
+static size_t const SMALL_DIM = 16;
+
+namespace {
+    /* declaration */
+    // scratch coordinates for the corners of up to two compacts, the heap is used only beyond SMALL_DIM
+    class BoundsBuffer {
+    public:
+        explicit BoundsBuffer(size_t size);
+        ~BoundsBuffer();
+
+        // nullptr when the heap storage could not be allocated
+        double* data();
+
+    private:
+        BoundsBuffer(BoundsBuffer const&)            = delete;
+        BoundsBuffer& operator=(BoundsBuffer const&) = delete;
 
+        double m_local[4 * SMALL_DIM];
+        double* m_data {nullptr};
+    };
+}
+
+/* implementation */
+BoundsBuffer::BoundsBuffer(size_t size) :
+    m_data(size <= 4 * SMALL_DIM ? m_local : new(std::nothrow) double[size]) {}
+
+BoundsBuffer::~BoundsBuffer() {
+    if (m_data != m_local) {
+        delete[] m_data;
+    }
+}
+
+double* BoundsBuffer::data() {
+    return m_data;
+}
+
+// left <comparison sign> right
+static VectorComparison compare(double const* l, double const* r, size_t dim, double tolerance) {
     VectorComparison vc = VectorComparison::VC_INCOMPARABLE;
-    for (size_t i = 0; i < l->getDim(); ++i) {
-        if (fabs(l->getCoord(i) - r->getCoord(i)) < tolerance)
+    for (size_t i = 0; i < dim; ++i) {
+        if (fabs(l[i] - r[i]) < tolerance)
             continue;
 
-        if (l->getCoord(i) > r->getCoord(i)) {
+        if (l[i] > r[i]) {
             if (vc ==  VectorComparison::VC_LESSER)
                 return VectorComparison::VC_INCOMPARABLE;
             vc = VectorComparison::VC_BIGGER;
         }
-        else if (l->getCoord(i) < r->getCoord(i)) {
+        else if (l[i] < r[i]) {
             if (vc ==  VectorComparison::VC_BIGGER)
                 return VectorComparison::VC_INCOMPARABLE;
             vc = VectorComparison::VC_LESSER;
@@ -38,6 +70,15 @@ static VectorComparison compare(IVector const* const l, IVector const* const r,
     return vc;
 }
 
+// closed box, as CompactImpl::contains
+static bool inside(double const* point, double const* lower, double const* upper, size_t dim) {
+    for (size_t i = 0; i < dim; ++i) {
+        if (point[i] < lower[i] || point[i] > upper[i])
+            return false;
+    }
+    return true;
+}
+
 static ReturnCode checkVectors(IVector const* comp1, IVector const* comp2) {
     if (comp1 == nullptr || comp2 == nullptr) {
         return ReturnCode::RC_NULL_PTR;
@@ -70,6 +111,48 @@ static ReturnCode checkCompacts(ICompact const* comp1, ICompact const* comp2) {
     return ReturnCode::RC_SUCCESS;
 }
 
+// lower1, upper1, lower2, upper2 one after another, read through the views
+static void readBounds(double* bounds, ICompact const* comp1, ICompact const* comp2) {
+    size_t dim = comp1->getDim();
+    comp1->getBeginView()->getCoords(0, dim, bounds);
+    comp1->getEndView()->getCoords(0, dim, bounds + dim);
+    comp2->getBeginView()->getCoords(0, dim, bounds + 2 * dim);
+    comp2->getEndView()->getCoords(0, dim, bounds + 3 * dim);
+}
+
+// checks the corners as createCompact does, no temporary vectors or compacts are made:
+// the allocations are the compact with its bound array and its two corner vectors
+static ICompact* createFromBounds(size_t dim, double const* bounds, double tolerance, ILogger* logger) {
+    double const* lower = bounds;
+    double const* upper = bounds + dim;
+    // exclude degeneracy of compact
+    for (size_t i = 0; i < dim; ++i) {
+        if (fabs(lower[i] - upper[i]) < tolerance) {
+            LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+            return nullptr;
+        }
+    }
+
+    if (compare(lower, upper, dim, tolerance) != VectorComparison::VC_LESSER) {
+        LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+        return nullptr;
+    }
+
+    ICompact* compact = new(std::nothrow) CompactImpl(dim, bounds, tolerance);
+    if (compact == nullptr) {
+        LOG(logger, ReturnCode::RC_NO_MEM);
+        return nullptr;
+    }
+
+    if (compact->getBeginView() == nullptr || compact->getEndView() == nullptr) {
+        LOG(logger, ReturnCode::RC_NO_MEM);
+        delete compact;
+        return nullptr;
+    }
+
+    return compact;
+}
+
 ICompact::Iterator::~Iterator() {}
 
 ICompact::~ICompact() {}
@@ -91,26 +174,17 @@ ICompact* ICompact::createCompact(IVector const* begin, IVector const* end, doub
         return nullptr;
     }
 
-    // exclude degeneracy of compact
-    for (size_t i = 0; i < begin->getDim(); ++i) {
-        if (fabs(begin->getCoord(i) - end->getCoord(i)) < tolerance) {
-            LOG(logger, ReturnCode::RC_INVALID_PARAMS);
-            return nullptr;
-        }
-    }
-
-    if (compare(begin, end, tolerance) != VectorComparison::VC_LESSER) {
-        LOG(logger, ReturnCode::RC_INVALID_PARAMS);
-        return nullptr;
-    }
-
-    ICompact* compact = new(std::nothrow) CompactImpl(begin, end, tolerance);
-    if (compact == nullptr) {
+    size_t dim = begin->getDim();
+    BoundsBuffer buffer(2 * dim);
+    double* bounds = buffer.data();
+    if (bounds == nullptr) {
         LOG(logger, ReturnCode::RC_NO_MEM);
         return nullptr;
     }
 
-    return compact;
+    begin->getCoords(0, dim, bounds);
+    end->getCoords(0, dim, bounds + dim);
+    return createFromBounds(dim, bounds, tolerance, logger);
 }
 
 ICompact* ICompact::_union(ICompact const* comp1, ICompact const* comp2, double tolerance, ILogger* logger) {
@@ -130,10 +204,21 @@ ICompact* ICompact::_union(ICompact const* comp1, ICompact const* comp2, double
         return nullptr;
     }
 
-    bool subsetFlag = false;
+    size_t dim = comp1->getDim();
+    BoundsBuffer buffer(4 * dim);
+    double* bounds = buffer.data();
+    if (bounds == nullptr) {
+        LOG(logger, ReturnCode::RC_NO_MEM);
+        return nullptr;
+    }
+    readBounds(bounds, comp1, comp2);
+    double const* begin1 = bounds;
+    double const* end1   = bounds + dim;
+    double const* begin2 = bounds + 2 * dim;
+    double const* end2   = bounds + 3 * dim;
 
-    rc = comp2->isSubset(comp1, subsetFlag);
-    if (rc == ReturnCode::RC_SUCCESS && subsetFlag) {
+    // one compact holds the other when it holds both of its corners
+    if (inside(begin2, begin1, end1, dim) && inside(end2, begin1, end1, dim)) {
         ICompact* result = comp1->clone();
         if (result == nullptr) {
             LOG(logger, ReturnCode::RC_NO_MEM);
@@ -142,8 +227,7 @@ ICompact* ICompact::_union(ICompact const* comp1, ICompact const* comp2, double
         return result;
     }
 
-    rc = comp1->isSubset(comp2, subsetFlag);
-    if (rc == ReturnCode::RC_SUCCESS && subsetFlag) {
+    if (inside(begin1, begin2, end2, dim) && inside(end1, begin2, end2, dim)) {
         ICompact* result = comp2->clone();
         if (result == nullptr) {
             LOG(logger, ReturnCode::RC_NO_MEM);
@@ -152,21 +236,10 @@ ICompact* ICompact::_union(ICompact const* comp1, ICompact const* comp2, double
         return result;
     }
 
-    size_t dim = comp1->getDim();
-    IVector* begin1 = comp1->getBegin();
-    IVector* begin2 = comp2->getBegin();
-    IVector* end1   = comp1->getEnd();
-    IVector* end2   = comp2->getEnd();
-    // TODO: remove asserts
-    assert(begin1 != nullptr);
-    assert(begin2 != nullptr);
-    assert(end1 != nullptr);
-    assert(end2 != nullptr);
-
     // compare begin vectors
     bool differenceFound = false;
     for (size_t i = 0; i < dim; ++i) {
-        if (fabs(begin1->getCoord(i) - begin2->getCoord(i)) > tolerance) {
+        if (fabs(begin1[i] - begin2[i]) > tolerance) {
             if (differenceFound) {
                 LOG(logger, ReturnCode::RC_INVALID_PARAMS);
                 return nullptr;
@@ -174,19 +247,7 @@ ICompact* ICompact::_union(ICompact const* comp1, ICompact const* comp2, double
             differenceFound = true;
         }
     }
-    bool containsFlag1 = false;
-    bool containsFlag2 = false;
-    rc = comp1->contains(end2, containsFlag1);
-    if (rc != ReturnCode::RC_SUCCESS) {
-        LOG(logger, rc);
-        return nullptr;
-    }
-    rc = comp2->contains(end1, containsFlag2);
-    if (rc != ReturnCode::RC_SUCCESS) {
-        LOG(logger, rc);
-        return nullptr;
-    }
-    if (!containsFlag1 && !containsFlag2) {
+    if (!inside(end2, begin1, end1, dim) && !inside(end1, begin2, end2, dim)) {
         LOG(logger, ReturnCode::RC_INVALID_PARAMS);
         return nullptr;
     }
@@ -194,7 +255,7 @@ ICompact* ICompact::_union(ICompact const* comp1, ICompact const* comp2, double
     // compare end vectors
     if (!differenceFound) {
         for (size_t i = 0; i < dim; ++i) {
-            if (fabs(end1->getCoord(i) - end2->getCoord(i)) > tolerance) {
+            if (fabs(end1[i] - end2[i]) > tolerance) {
                 if (differenceFound) {
                     LOG(logger, ReturnCode::RC_INVALID_PARAMS);
                     return nullptr;
@@ -202,38 +263,21 @@ ICompact* ICompact::_union(ICompact const* comp1, ICompact const* comp2, double
                 differenceFound = true;
             }
         }
-        containsFlag1 = false;
-        containsFlag2 = false;
-        rc = comp1->contains(begin2, containsFlag1);
-        if (rc != ReturnCode::RC_SUCCESS) {
-            LOG(logger, rc);
-            return nullptr;
-        }
-        rc = comp2->contains(begin1, containsFlag2);
-        if (rc != ReturnCode::RC_SUCCESS) {
-            LOG(logger, rc);
-            return nullptr;
-        }
-        if (!containsFlag1 && !containsFlag2) {
+        if (!inside(begin2, begin1, end1, dim) && !inside(begin1, begin2, end2, dim)) {
             LOG(logger, ReturnCode::RC_INVALID_PARAMS);
             return nullptr;
         }
     }
 
-    IVector* begin = (compare(begin1, begin2, tolerance) == VectorComparison::VC_LESSER) ?
-                      begin1 : begin2;
-    IVector* end   = (compare(end1, end2, tolerance) == VectorComparison::VC_BIGGER) ?
-                      end1 : end2;
-
-
-    ICompact* compact = ICompact::createCompact(begin, end, tolerance, logger);
-
-    delete(begin1);
-    delete(begin2);
-    delete(end1);
-    delete(end2);
+    // the chosen corners are moved into the first compact's place
+    if (compare(begin1, begin2, dim, tolerance) != VectorComparison::VC_LESSER) {
+        std::copy(begin2, begin2 + dim, bounds);
+    }
+    if (compare(end1, end2, dim, tolerance) != VectorComparison::VC_BIGGER) {
+        std::copy(end2, end2 + dim, bounds + dim);
+    }
 
-    return compact;
+    return createFromBounds(dim, bounds, tolerance, logger);
 }
 
 ICompact* ICompact::intersection(ICompact const* comp1, ICompact const* comp2, double tolerance, ILogger* logger) {
@@ -253,52 +297,28 @@ ICompact* ICompact::intersection(ICompact const* comp1, ICompact const* comp2, d
         return nullptr;
     }
 
-    bool intersects = false;
-    rc = comp1->intersects(comp2, intersects);
-    if (rc != ReturnCode::RC_SUCCESS) {
-        LOG(logger, rc);
+    size_t dim = comp1->getDim();
+    BoundsBuffer buffer(4 * dim);
+    double* bounds = buffer.data();
+    if (bounds == nullptr) {
+        LOG(logger, ReturnCode::RC_NO_MEM);
         return nullptr;
     }
+    readBounds(bounds, comp1, comp2);
+    double* lower1 = bounds;
+    double* upper1 = bounds + dim;
+    double const* lower2 = bounds + 2 * dim;
+    double const* upper2 = bounds + 3 * dim;
 
-    if (!intersects)
-        return nullptr;
-
-    IVector* begin1 = comp1->getBegin();
-    IVector* begin2 = comp2->getBegin();
-    IVector* end1   = comp1->getEnd();
-    IVector* end2   = comp2->getEnd();
-
-    // TODO: remove asserts
-    assert(begin1 != nullptr);
-    assert(begin2 != nullptr);
-    assert(end1 != nullptr);
-    assert(end2 != nullptr);
-
-    size_t dim = comp1->getDim();
-    double* data = new(std::nothrow) double[dim]{0};
-    assert(data != nullptr);
-
-    IVector* begin = IVector::createVector(dim, data, logger);
-    IVector* end   = IVector::createVector(dim, data, logger);
-    assert(begin != nullptr);
-    assert(end != nullptr);
-
+    // the first corners become the ones of the intersection, disjoint compacts have none
     for (size_t i = 0; i < dim; ++i) {
-        begin->setCoord(i, std::max(begin1->getCoord(i), begin2->getCoord(i)));
-        end->setCoord(i, std::min(end1->getCoord(i), end2->getCoord(i)));
+        lower1[i] = std::max(lower1[i], lower2[i]);
+        upper1[i] = std::min(upper1[i], upper2[i]);
+        if (lower1[i] > upper1[i])
+            return nullptr;
     }
 
-    ICompact* compact = ICompact::createCompact(begin, end, tolerance, logger);
-
-    delete(begin1);
-    delete(begin2);
-    delete(end1);
-    delete(end2);
-    delete[] data;
-    delete begin;
-    delete end;
-
-    return compact;
+    return createFromBounds(dim, bounds, tolerance, logger);
 }
 
 ICompact* ICompact::convex(ICompact const* comp1, ICompact const* comp2, double tolerance, ILogger* logger) {
@@ -318,69 +338,62 @@ ICompact* ICompact::convex(ICompact const* comp1, ICompact const* comp2, double
         return nullptr;
     }
 
-    // here I got a lesson:
-    // leave using goto for C, not C++
-    IVector* begin1 = nullptr;
-    IVector* begin2 = nullptr;
-    IVector* end1   = nullptr;
-    IVector* end2   = nullptr;
-    size_t dim      = 0;
-    double* beginData = nullptr;
-    double*   endData = nullptr;
-    IVector* begin    = nullptr;
-    IVector*   end    = nullptr;
-    ICompact* compact = nullptr;
-
-    rc = ReturnCode::RC_UNKNOWN;
-    begin1 = comp1->getBegin();
-    if (begin1 == nullptr) goto convex_return;
-    begin2 = comp2->getBegin();
-    if (begin2 == nullptr) goto convex_delete_begin1;
-    end1   = comp1->getEnd();
-    if (end1   == nullptr) goto convex_delete_begin2;
-    end2   = comp2->getEnd();
-    if (end2   == nullptr) goto convex_delete_end1;
-
-    rc = ReturnCode::RC_NO_MEM;
-    dim = comp1->getDim();
-    beginData = new(std::nothrow) double[dim];
-    if (beginData == nullptr) goto convex_delete_end2;
-    endData   = new(std::nothrow) double[dim];
-    if (endData   == nullptr) goto convex_delete_begin_data;
-    for (size_t i = 0; i < dim; ++i) {
-        beginData[i] = begin1->getCoord(i) < begin2->getCoord(i) ? begin1->getCoord(i) : begin2->getCoord(i);
-          endData[i] =   end1->getCoord(i) >   end2->getCoord(i) ?   end1->getCoord(i) :   end2->getCoord(i);
-    }
-
-    rc = ReturnCode::RC_UNKNOWN;
-    begin = IVector::createVector(dim, beginData, logger);
-    if (begin == nullptr) goto convex_delete_end_data;
-    end = IVector::createVector(dim, endData, logger);
-    if (end   == nullptr) goto convex_delete_begin;
-    compact = ICompact::createCompact(begin, end, tolerance, logger);
-    rc = compact != nullptr ? ReturnCode::RC_SUCCESS : ReturnCode::RC_UNKNOWN;
-
-    delete end;
-convex_delete_begin:
-    delete begin;
-convex_delete_end_data:
-    delete endData;
-convex_delete_begin_data:
-    delete beginData;
-convex_delete_end2:
-    delete end2;
-convex_delete_end1:
-    delete end1;
-convex_delete_begin2:
-    delete begin2;
-convex_delete_begin1:
-    delete begin1;
-convex_return:
-    if (rc != ReturnCode::RC_SUCCESS) {
-        LOG(logger, rc);
+    size_t dim = comp1->getDim();
+    BoundsBuffer buffer(4 * dim);
+    double* bounds = buffer.data();
+    if (bounds == nullptr) {
+        LOG(logger, ReturnCode::RC_NO_MEM);
         return nullptr;
     }
-    else {
-        return compact;
+    readBounds(bounds, comp1, comp2);
+    double* lower1 = bounds;
+    double* upper1 = bounds + dim;
+    double const* lower2 = bounds + 2 * dim;
+    double const* upper2 = bounds + 3 * dim;
+
+    // the first corners become the ones of the hull
+    for (size_t i = 0; i < dim; ++i) {
+        lower1[i] = std::min(lower1[i], lower2[i]);
+        upper1[i] = std::max(upper1[i], upper2[i]);
     }
+
+    return createFromBounds(dim, bounds, tolerance, logger);
+}
+
+ReturnCode ICompact::findOverlaps(std::vector<ICompact const*> const& comps, std::vector<std::pair<size_t, size_t>>& pairs, ILogger* logger) {
+    pairs.clear();
+    if (comps.empty()) {
+        return ReturnCode::RC_SUCCESS;
+    }
+
+    for (size_t j = 0; j < comps.size(); ++j) {
+        if (comps[j] == nullptr) {
+            LOG(logger, ReturnCode::RC_NULL_PTR);
+            return ReturnCode::RC_NULL_PTR;
+        }
+        if (comps[j]->getDim() != comps[0]->getDim()) {
+            LOG(logger, ReturnCode::RC_WRONG_DIM);
+            return ReturnCode::RC_WRONG_DIM;
+        }
+    }
+
+    // bounds are read through the views once per compact, the sweep touches no compact afterwards
+    size_t dim = comps[0]->getDim();
+    try {
+        std::vector<double> bounds(2 * dim);
+        BoxSweep sweep;
+        sweep.reset(dim, comps.size());
+        for (size_t j = 0; j < comps.size(); ++j) {
+            comps[j]->getBeginView()->getCoords(0, dim, bounds.data());
+            comps[j]->getEndView()->getCoords(0, dim, bounds.data() + dim);
+            sweep.setBox(j, bounds.data(), bounds.data() + dim);
+        }
+        sweep.findOverlaps(pairs);
+    }
+    catch (std::bad_alloc const&) {
+        pairs.clear();
+        LOG(logger, ReturnCode::RC_NO_MEM);
+        return ReturnCode::RC_NO_MEM;
+    }
+    return ReturnCode::RC_SUCCESS;
 }
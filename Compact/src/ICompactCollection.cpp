@@ -0,0 +1,89 @@
+#include "../include/ICompactCollection.h"
+#include "CompactCollectionImpl.cpp"
+#include <cmath>    // isnan
+#include <new>      // nothrow
+
+ICompactCollection::~ICompactCollection() {}
+
+ICompactCollection* ICompactCollection::createCollection(size_t dim, double tolerance, ILogger* logger) {
+    if (dim == 0) {
+        LOG(logger, ReturnCode::RC_ZERO_DIM);
+        return nullptr;
+    }
+
+    if (std::isnan(tolerance)) {
+        LOG(logger, ReturnCode::RC_NAN);
+        return nullptr;
+    }
+
+    if (tolerance < 0.0) {
+        LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+        return nullptr;
+    }
+
+    ICompactCollection* collection = CompactCollectionImpl::create(dim, tolerance);
+    if (collection == nullptr) {
+        LOG(logger, ReturnCode::RC_NO_MEM);
+        return nullptr;
+    }
+
+    return collection;
+}
+
+ICompactCollection* ICompactCollection::_union(ICompactCollection const* coll1, ICompactCollection const* coll2, double tolerance, ILogger* logger) {
+    if (coll1 == nullptr || coll2 == nullptr) {
+        LOG(logger, ReturnCode::RC_NULL_PTR);
+        return nullptr;
+    }
+
+    if (coll1->getDim() != coll2->getDim()) {
+        LOG(logger, ReturnCode::RC_WRONG_DIM);
+        return nullptr;
+    }
+
+    ICompactCollection* collection = createCollection(coll1->getDim(), tolerance, logger);
+    if (collection == nullptr) {
+        return nullptr;
+    }
+
+    ReturnCode rc = collection->addAll(coll1);
+    if (rc == ReturnCode::RC_SUCCESS) {
+        rc = collection->addAll(coll2);
+    }
+    if (rc != ReturnCode::RC_SUCCESS) {
+        LOG(logger, rc);
+        delete collection;
+        return nullptr;
+    }
+
+    return collection;
+}
+
+ICompactCollection* ICompactCollection::_union(ICompact const* comp1, ICompact const* comp2, double tolerance, ILogger* logger) {
+    if (comp1 == nullptr || comp2 == nullptr) {
+        LOG(logger, ReturnCode::RC_NULL_PTR);
+        return nullptr;
+    }
+
+    if (comp1->getDim() != comp2->getDim()) {
+        LOG(logger, ReturnCode::RC_WRONG_DIM);
+        return nullptr;
+    }
+
+    ICompactCollection* collection = createCollection(comp1->getDim(), tolerance, logger);
+    if (collection == nullptr) {
+        return nullptr;
+    }
+
+    ReturnCode rc = collection->add(comp1);
+    if (rc == ReturnCode::RC_SUCCESS) {
+        rc = collection->add(comp2);
+    }
+    if (rc != ReturnCode::RC_SUCCESS) {
+        LOG(logger, rc);
+        delete collection;
+        return nullptr;
+    }
+
+    return collection;
+}
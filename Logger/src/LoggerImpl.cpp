@@ -2,6 +2,7 @@
 #include <iostream> // cerr
 #include <new>		// nothrow
 #include <vector>   // vector
+#include <mutex>    // mutex, lock_guard
 //#include <time.h>	// time_t, ctime, ctime_s
 #include <ctime>    // time_t, ctime, ctime_s
 #include <stdio.h>	// FILE, fopen, fopen_s
@@ -56,6 +57,8 @@ static char const* RC_MESSAGES[(size_t)ReturnCode::RC_UNKNOWN + 1] = {
  };
 
 LoggerImpl* LoggerImpl::instance = nullptr;
+// clients register and log from several threads, e.g. with a concurrent set
+static std::mutex g_loggerLock;
 
 /* errors caused by misuse of logger, written to std::cerr */
 char const* LoggerImpl::LOGGER_IMPL_NO_MEM	  = "Not enough memory to allocate new LoggerImpl";
@@ -72,6 +75,7 @@ ILogger* LoggerImpl::getLogger(void* client) {
         INNER_LOG(LOGGER_IMPL_NULL_PTR);
         return nullptr;
     }
+	std::lock_guard<std::mutex> guard(g_loggerLock);
 	if (instance == nullptr) {
 		instance = new(std::nothrow) LoggerImpl();
 		if (instance == nullptr) {
@@ -103,6 +107,7 @@ void LoggerImpl::releaseLogger(void* client) {
         INNER_LOG(LOGGER_IMPL_NULL_PTR);
         return;
     }
+	std::lock_guard<std::mutex> guard(g_loggerLock);
 	if (instance == nullptr) {
 		INNER_LOG(LOGGER_IMPL_DESTROY_I);
 		return;
@@ -121,6 +126,7 @@ void LoggerImpl::releaseLogger(void* client) {
 }
 
 void LoggerImpl::log(char const* message, ReturnCode returnCode) {
+	std::lock_guard<std::mutex> guard(g_loggerLock);
 	if (instance == nullptr) {
 		INNER_LOG(LOGGER_IMPL_LOG_I);
 		return;
@@ -145,6 +151,7 @@ void LoggerImpl::log(char const* message, ReturnCode returnCode) {
 }
 
 ReturnCode LoggerImpl::setLogFile(char const* logFileName) {
+	std::lock_guard<std::mutex> guard(g_loggerLock);
 	if (m_logfile != NULL) {
 		fflush(m_logfile);
 		fclose(m_logfile);
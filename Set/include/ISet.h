@@ -6,25 +6,168 @@
 #include "../../Util/ReturnCode.h"
 #include "../../Util/Export.h"
 #include <cstddef> // size_t
+#include <vector>  // vector
 
 class DECLSPEC ISet {
 public:
+	class Visitor {
+	public:
+		// point is a read-only view into the set, valid during the call only;
+		// returning false stops the traversal
+		virtual bool visit(size_t ind, double const* point) = 0;
+
+		Visitor() = default;
+		virtual ~Visitor() = 0;
+
+	private:
+		Visitor(Visitor const&)			   = delete;
+		Visitor& operator=(Visitor const&) = delete;
+	};
+
+	// forward-only stream of the points of a lazily computed set
+	class Cursor {
+	public:
+		// point is a read-only view valid until the next call; RC_OUT_OF_BOUNDS once every point
+		// was handed out. the operands must stay unchanged while the cursor is in use
+		virtual ReturnCode next(double const*& point) = 0;
+		virtual size_t getDim() const = 0;
+
+		Cursor() = default;
+		virtual ~Cursor() = 0;
+
+	private:
+		Cursor(Cursor const&)			 = delete;
+		Cursor& operator=(Cursor const&) = delete;
+	};
+
+	// how erase(size_t) fills the hole left by the point
+	enum class EraseMode {
+		EM_ORDERED,		// later points shift down, insertion order is kept
+		EM_UNORDERED,	// the last point moves into the hole
+		// the slot is marked erased and get() reports RC_ELEM_NOT_FOUND for it,
+		// numbers of other points stay valid until compaction, which runs on compact()
+		// or on insert once erased slots outnumber live points
+		EM_TOMBSTONE
+	};
+
 	static ISet* createSet(ILogger* logger = nullptr);
+	// bulk construction from count row-major points. of points closer than tolerance the first one is kept,
+	// as repeated insert would do, and the kept points are stored in spatial order with the lookup index ready
+	static ISet* createSet(size_t dim, size_t count, double const* points, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
+	// balanced KD-tree storage, suited for nearest neighbour and radius queries
+	static ISet* createKDTreeSet(ILogger* logger = nullptr);
+	// thread-safe set, lock-striped by grid cells as wide as the tolerance. of two points closer than
+	// the tolerance the lexicographically smaller one is kept whatever the order of their inserts; with
+	// three or more points in a chain of close neighbours the kept ones may depend on the order. erased
+	// points stay as tombstones (EM_TOMBSTONE is the only erase mode), clear and compact are not thread-safe
+	static ISet* createConcurrentSet(double tolerance, ILogger* logger = nullptr);
+
+	// approximate index for high-dimensional points: every table hashes a point by random projections
+	// quantized to buckets width times the tolerance wide. more tables raise recall, more projections
+	// per table make buckets more selective, candidates are always verified as by IVector::equals
+	struct LSHParams {
+		size_t tables;
+		size_t projections;
+		double width;
+		// lookups that found nothing are repeated by a full scan and erase by a vector always scans,
+		// so misses and erases are exact. find may still report a later match than the first one
+		bool scanFallback;
+		unsigned long long seed;
+	};
+	// lookups done through the index and the number of them that fell back to a full scan
+	struct LSHStats {
+		size_t lookups;
+		size_t fullScans;
+	};
+	static ISet* createLSHSet(LSHParams const& params, ILogger* logger = nullptr);
+	// RC_INVALID_PARAMS for sets without the index
+	static ReturnCode getLSHStats(ISet const* set, LSHStats& stats, ILogger* logger = nullptr);
+
+	// heap bytes held by a set, unused capacity included. hash tables are estimated from their sizes
+	struct MemoryUsage {
+		// coordinates of the points and room reserved for more
+		size_t points;
+		// lookup index, filter and tree
+		size_t index;
+		// the set object itself, tombstones and other bookkeeping
+		size_t overhead;
+	};
+
+	// versioned binary snapshot holding the points and a grid built for the tolerance,
+	// zero tolerance stores the points only. tombstones are not saved, points are renumbered in order
+	static ReturnCode saveSet(ISet const* set, char const* fileName, double tolerance, ILogger* logger = nullptr);
+	// serves queries straight from the memory-mapped snapshot, queries up to the saved tolerance use
+	// the stored grid. the first change copies the points into memory and the mapping is released
+	static ISet* createMappedSet(char const* fileName, ILogger* logger = nullptr);
+
 	static ISet* _union(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
 	static ISet* difference(ISet const* minuend, ISet const* subtrahend, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
 	static ISet* symmetricDifference(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
 	static ISet* intersection(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
+	// multithreaded versions for large sets, threads == 0 uses every hardware thread.
+	// the results are identical to the ones of the sequential operations
+	static ISet* parallelUnion(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, size_t threads, ILogger* logger = nullptr);
+	static ISet* parallelDifference(ISet const* minuend, ISet const* subtrahend, IVector::Norm norm, double tolerance, size_t threads, ILogger* logger = nullptr);
+	static ISet* parallelIntersection(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, size_t threads, ILogger* logger = nullptr);
+	// lazy versions stream the points in the order of the eager ones without building the result:
+	// every point of one operand is checked by find of the other, so the lookup structures of the
+	// operands do the work and the cursor keeps O(1) state. lazyUnion and lazySymmetricDifference drop
+	// points of set2 matching set1 only and equal the eager ones when no two points of set2 are closer
+	// than the tolerance
+	static Cursor* lazyUnion(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
+	static Cursor* lazyDifference(ISet const* minuend, ISet const* subtrahend, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
+	static Cursor* lazySymmetricDifference(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
+	static Cursor* lazyIntersection(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
+	// chained stages filter the stream of another cursor, which is owned by the result and deleted on failure too
+	static Cursor* lazyDifference(Cursor* minuend, ISet const* subtrahend, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
+	static Cursor* lazyIntersection(Cursor* source, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger = nullptr);
 
 	virtual ReturnCode insert(IVector const* vector, IVector::Norm norm, double tolerance) = 0;
 	virtual ReturnCode erase(IVector const* vector, IVector::Norm norm, double tolerance)  = 0;
 	virtual ReturnCode erase(size_t ind) 												   = 0;
+	// removes every point closer than tolerance to some point of the other set, in one pass
+	virtual ReturnCode eraseAll(ISet const* other, IVector::Norm norm, double tolerance)   = 0;
 	virtual void clear() 																   = 0;
+	// switching away from EM_TOMBSTONE compacts the set
+	virtual ReturnCode setEraseMode(EraseMode mode)										   = 0;
+	// drops tombstones, remaining points are renumbered in order
+	virtual void compact()																   = 0;
+	// approximate membership filter over cells as wide as the tolerance of the query, off by default.
+	// find and insert skip the point data when no stored point can lie that close. the filter is built
+	// by the first query, kept up to date by insert and rebuilt by the next query after erase
+	virtual ReturnCode setFilter(bool enabled)											   = 0;
+	// sorts the points along the Z-order curve over cells cellSize wide, so close points get close numbers
+	// and lie in nearby memory. tombstones are dropped and the points are renumbered
+	virtual ReturnCode reorder(double cellSize)											   = 0;
+	// keeps the points in Z-order: the set is reordered and every insert goes to its place on the curve,
+	// shifting numbers of later points. such an insert costs O(n), it moves the later points and renumbers
+	// them in the lookup index. EM_UNORDERED erases shift as EM_ORDERED ones meanwhile.
+	// zero cellSize turns the mode off and keeps the current order
+	virtual ReturnCode setSpatialOrder(double cellSize)									   = 0;
+	// room for count points in total, an empty set reserves it for the dimension of the first insert
+	virtual ReturnCode reserve(size_t count)											   = 0;
+	// releases unused capacity, lazily built lookup structures are dropped until the next query
+	virtual void shrinkToFit()															   = 0;
 
+	// const members may be called from several threads at once while no thread changes the set,
+	// queries building a lazy lookup structure take turns on it
 	virtual ReturnCode find(IVector const* vector, IVector::Norm norm, double tolerance, size_t& ind) 	const = 0;
 	virtual ReturnCode get(IVector*& dst, size_t ind) 													const = 0;
 	virtual size_t getDim() 																			const = 0;
 	virtual size_t getSize() 																			const = 0;
 	virtual ISet* clone() 																				const = 0;
+	virtual void getMemoryUsage(MemoryUsage& usage) 													const = 0;
+
+	// indices of the k closest points, nearest first (ties by index)
+	virtual ReturnCode findNearest(IVector const* vector, IVector::Norm norm, size_t k, std::vector<size_t>& inds)         const = 0;
+	// indices of all points not farther than radius, in ascending order
+	virtual ReturnCode findInRadius(IVector const* vector, IVector::Norm norm, double radius, std::vector<size_t>& inds) const = 0;
+
+	// zero-copy traversal, points are handed out in index order
+	virtual ReturnCode forEach(Visitor& visitor) const = 0;
+	// next contiguous row-major run of count points starting at cursor, cursor moves past it;
+	// RC_OUT_OF_BOUNDS when every point was handed out. views stay valid until the set changes
+	virtual ReturnCode getBlock(size_t& cursor, double const*& block, size_t& count) const = 0;
 
 	ISet() = default;
 	virtual ~ISet() = 0;
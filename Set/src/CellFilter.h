@@ -0,0 +1,145 @@
+#ifndef CELL_FILTER_H
+#define CELL_FILTER_H
+
+#include "GridIndex.h"
+#include <cstddef>	// size_t
+#include <atomic>	// atomic
+#include <new>		// nothrow
+
+namespace {
+	/* declaration */
+	// bloom filter over grid cells as wide as the tolerance. a point marks its own cell and every
+	// neighbour cell, so a query probes its own cell only and a negative answer proves that no point
+	// lies closer than the tolerance. bits are never cleared, erased points leave false positives
+	// until the owner rebuilds the filter. bits are set atomically, so adds may race with lookups
+	class CellFilter {
+	public:
+		CellFilter() = default;
+		~CellFilter();
+		CellFilter(CellFilter const&) = delete;
+		CellFilter& operator=(CellFilter const&) = delete;
+
+		// sizes the filter for the expected number of points, returns false when there is no memory
+		bool reset(size_t dim, double tolerance, size_t expected);
+		void clear();
+		bool suits(double tolerance) const;
+		// more points were added than the filter was sized for, false positives grow
+		bool full() const;
+
+		void add(double const* point);
+		bool mayContain(double const* point) const;
+		// heap bytes held by the bits
+		size_t memoryUsage() const;
+
+	private:
+		static unsigned long long hash(GridIndex::CellKey const& key);
+
+		GridIndex m_grid;
+		std::atomic<unsigned long long>* m_words {nullptr};
+		size_t m_wordMask {0};
+		size_t m_capacity {0};
+		std::atomic<size_t> m_added {0};
+	};
+}
+
+/* implementation */
+// about 2% false positives at 8 bits and 4 probes per marked cell
+static size_t const CELL_FILTER_BITS_PER_KEY = 8;
+static size_t const CELL_FILTER_PROBES = 4;
+
+CellFilter::~CellFilter() {
+	clear();
+}
+
+bool CellFilter::reset(size_t dim, double tolerance, size_t expected) {
+	clear();
+	m_grid.reset(dim, tolerance);
+
+	size_t neighbours = 1;
+	for (size_t i = 0; i < dim && i < GridIndex::MAX_KEY_DIM; ++i) {
+		neighbours *= 3;
+	}
+	size_t words = 1;
+	while (words * 64 < expected * neighbours * CELL_FILTER_BITS_PER_KEY) {
+		words *= 2;
+	}
+
+	m_words = new(std::nothrow) std::atomic<unsigned long long>[words];
+	if (m_words == nullptr) {
+		m_grid.clear();
+		return false;
+	}
+	for (size_t i = 0; i < words; ++i) {
+		m_words[i].store(0, std::memory_order_relaxed);
+	}
+	m_wordMask = words - 1;
+	m_capacity = expected;
+	return true;
+}
+
+void CellFilter::clear() {
+	delete[] m_words;
+	m_words = nullptr;
+	m_wordMask = 0;
+	m_capacity = 0;
+	m_added = 0;
+	m_grid.clear();
+}
+
+// as for the grid, coarser cells stay correct but let more misses through
+bool CellFilter::suits(double tolerance) const {
+	return m_words != nullptr && m_grid.suits(tolerance);
+}
+
+bool CellFilter::full() const {
+	return m_added.load(std::memory_order_relaxed) > m_capacity;
+}
+
+unsigned long long CellFilter::hash(GridIndex::CellKey const& key) {
+	unsigned long long hash = 1469598103934665603ULL;
+	for (size_t i = 0; i < GridIndex::MAX_KEY_DIM; ++i) {
+		hash ^= (unsigned long long)key.coord[i];
+		hash *= 1099511628211ULL;
+	}
+	// final mix spreads the low bits used for word and bit numbers
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+void CellFilter::add(double const* point) {
+	if (m_words == nullptr) {
+		return;
+	}
+
+	m_grid.visitCells(point, [&](GridIndex::CellKey const& key) {
+		unsigned long long h = hash(key);
+		unsigned long long step = (h >> 32) | 1;
+		for (size_t i = 0; i < CELL_FILTER_PROBES; ++i, h += step) {
+			m_words[(h >> 6) & m_wordMask].fetch_or(1ULL << (h & 63), std::memory_order_relaxed);
+		}
+		return false;
+	});
+	++m_added;
+}
+
+bool CellFilter::mayContain(double const* point) const {
+	if (m_words == nullptr) {
+		return true;
+	}
+
+	unsigned long long h = hash(m_grid.key(point));
+	unsigned long long step = (h >> 32) | 1;
+	for (size_t i = 0; i < CELL_FILTER_PROBES; ++i, h += step) {
+		if ((m_words[(h >> 6) & m_wordMask].load(std::memory_order_relaxed) & (1ULL << (h & 63))) == 0)
+			return false;
+	}
+	return true;
+}
+
+size_t CellFilter::memoryUsage() const {
+	return m_words == nullptr ? 0 : (m_wordMask + 1) * sizeof(m_words[0]);
+}
+
+#endif /* CELL_FILTER_H */
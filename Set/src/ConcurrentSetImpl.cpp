@@ -0,0 +1,936 @@
+#include "../include/ISet.h"
+#include "CellFilter.h"
+#include "GridIndex.h"
+#include "PointDistance.h"
+#include "PointsView.h"
+#include <stdlib.h>
+#include <cmath>		 // isnan, isinf
+#include <vector>		 // vector
+#include <utility>		 // pair
+#include <algorithm>	 // partial_sort, sort, unique
+#include <unordered_map> // unordered_map
+#include <atomic>		 // atomic
+#include <mutex>		 // mutex, lock_guard
+#include <thread>		 // this_thread::yield
+#include <new>			 // nothrow
+
+namespace {
+	/* declaration */
+	// reader-writer spin lock, readers never block each other
+	class StripeLock {
+	public:
+		StripeLock() = default;
+		StripeLock(StripeLock const&) = delete;
+		StripeLock& operator=(StripeLock const&) = delete;
+
+		void lockShared();
+		void unlockShared();
+		void lock();
+		void unlock();
+
+	private:
+		// number of readers, -1 while a writer holds the lock
+		std::atomic<int> m_state {0};
+	};
+
+	// thread-safe set. points are bucketed by grid cells as wide as the tolerance given on creation,
+	// cells are spread over lock stripes. insert, erase and find lock only the stripes of the cells
+	// around the point, exclusively or shared, in ascending order; wider tolerances lock every stripe.
+	// coordinates are written once into segments that never move and slots change state atomically,
+	// so get, forEach and getBlock take no locks.
+	// erased slots stay as tombstones, clear, compact and setFilter need the set to be used by one thread only.
+	// the filter has a fixed size between compactions and keeps bits of erased points until compact
+	class ConcurrentSetImpl : public ISet {
+	private:
+		static size_t const STRIPES = 64;
+		// segment s holds SEGMENT_BASE << s slots, so slot numbers never move
+		static size_t const SEGMENT_BITS = 10;
+		static size_t const SEGMENT_BASE = (size_t)1 << SEGMENT_BITS;
+		static size_t const SEGMENTS = 48;
+		// points the filter is sized for at least, it cannot grow while other threads use it
+		static size_t const FILTER_POINTS = (size_t)1 << 14;
+
+		enum SlotState : unsigned char {
+			SLOT_WRITING = 0,
+			SLOT_LIVE,
+			SLOT_ERASED
+		};
+
+		typedef GridIndex::CellKey CellKey;
+		typedef std::unordered_map<CellKey, std::vector<size_t>, GridIndex::CellKeyHash> Cells;
+
+		struct Stripe {
+			StripeLock lock;
+			Cells cells;
+		};
+
+		double m_tolerance;
+		ILogger* m_logger {nullptr};
+
+		std::atomic<size_t> m_dim {0};
+		std::mutex m_setupLock;
+		// computes cell keys only, its own cells stay empty
+		GridIndex m_grid;
+		bool m_filterEnabled {false};
+		CellFilter m_filter;
+
+		std::vector<Stripe> m_stripes;
+
+		std::atomic<double*> m_points[SEGMENTS];
+		std::atomic<std::atomic<unsigned char>*> m_states[SEGMENTS];
+		std::mutex m_growLock;
+		std::atomic<size_t> m_reserved {0};
+		std::atomic<size_t> m_live {0};
+		// points reserved by reserve() before the dimension is known, applied by the first insert
+		std::atomic<size_t> m_reservedCount {0};
+
+		static void locate(size_t ind, size_t& segment, size_t& offset);
+		double const* point(size_t ind) const;
+		unsigned char state(size_t ind) const;
+		size_t stripeOf(CellKey const& key) const;
+
+		ReturnCode prepare(IVector const* vector, double tolerance, std::vector<double>& query) const;
+		ReturnCode setupDim(size_t dim);
+		void collectStripes(double const* query, double tolerance, std::vector<size_t>& stripes) const;
+		void lockStripes(std::vector<size_t> const& stripes, bool exclusive) const;
+		void unlockStripes(std::vector<size_t> const& stripes, bool exclusive) const;
+		template<class Action>
+		void visitCandidates(double const* query, double tolerance, Action action) const;
+
+		bool allocateSegment(size_t segment, size_t dim);
+		bool allocateSlots(size_t count, size_t dim);
+		ReturnCode append(double const* coords);
+		void kill(size_t ind);
+		void release();
+
+	public:
+		explicit ConcurrentSetImpl(double tolerance);
+		~ConcurrentSetImpl() override;
+
+		ReturnCode insert(IVector const* vector, IVector::Norm norm, double tolerance) 	override;
+		ReturnCode erase(IVector const* vector, IVector::Norm norm, double tolerance) 	override;
+		ReturnCode erase(size_t index) 													override;
+		ReturnCode eraseAll(ISet const* other, IVector::Norm norm, double tolerance) 	override;
+		void clear() 																	override;
+		ReturnCode setEraseMode(EraseMode mode) 										override;
+		void compact() 																	override;
+		ReturnCode setFilter(bool enabled) 												override;
+		ReturnCode reserve(size_t count) 												override;
+		ReturnCode reorder(double cellSize) 											override;
+		ReturnCode setSpatialOrder(double cellSize) 									override;
+		void shrinkToFit() 																override;
+
+		ReturnCode find(IVector const* vector, IVector::Norm norm, double tolerance, size_t& ind) 	const override;
+		ReturnCode get(IVector*& dst, size_t ind) 													const override;
+		size_t getDim() 																			const override;
+		size_t getSize() 																			const override;
+		ISet* clone() 																				const override;
+		void getMemoryUsage(MemoryUsage& usage) 													const override;
+
+		ReturnCode findNearest(IVector const* vector, IVector::Norm norm, size_t k, std::vector<size_t>& inds)         const override;
+		ReturnCode findInRadius(IVector const* vector, IVector::Norm norm, double radius, std::vector<size_t>& inds) const override;
+
+		ReturnCode forEach(Visitor& visitor) 										const override;
+		ReturnCode getBlock(size_t& cursor, double const*& block, size_t& count) 	const override;
+	};
+}
+
+/* implementation */
+void StripeLock::lockShared() {
+	for (;;) {
+		int state = m_state.load(std::memory_order_relaxed);
+		if (state >= 0 && m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire)) {
+			return;
+		}
+		std::this_thread::yield();
+	}
+}
+
+void StripeLock::unlockShared() {
+	m_state.fetch_sub(1, std::memory_order_release);
+}
+
+void StripeLock::lock() {
+	for (;;) {
+		int state = 0;
+		if (m_state.compare_exchange_weak(state, -1, std::memory_order_acquire)) {
+			return;
+		}
+		std::this_thread::yield();
+	}
+}
+
+void StripeLock::unlock() {
+	m_state.store(0, std::memory_order_release);
+}
+
+size_t const ConcurrentSetImpl::STRIPES;
+size_t const ConcurrentSetImpl::SEGMENT_BITS;
+size_t const ConcurrentSetImpl::SEGMENT_BASE;
+size_t const ConcurrentSetImpl::SEGMENTS;
+size_t const ConcurrentSetImpl::FILTER_POINTS;
+
+// of two points closer than the tolerance the set keeps the lexicographically smaller one, so the outcome
+// of concurrent inserts of a close pair does not depend on their timing. chains are not covered: for
+// a < b < c with only neighbours close, inserting a, b, c keeps {a, c} while c, b, a keeps {a}
+static bool lexicographicallyLess(double const* a, double const* b, size_t dim) {
+	for (size_t i = 0; i < dim; ++i) {
+		if (a[i] != b[i])
+			return a[i] < b[i];
+	}
+	return false;
+}
+
+ConcurrentSetImpl::ConcurrentSetImpl(double tolerance) :
+	m_tolerance(tolerance),
+	m_stripes(STRIPES) {
+	for (size_t s = 0; s < SEGMENTS; ++s) {
+		m_points[s].store(nullptr);
+		m_states[s].store(nullptr);
+	}
+	m_logger = ILogger::createLogger(this);
+}
+
+ConcurrentSetImpl::~ConcurrentSetImpl() {
+	release();
+
+	if (m_logger != nullptr) {
+		m_logger->releaseLogger(this);
+	}
+}
+
+void ConcurrentSetImpl::release() {
+	for (size_t s = 0; s < SEGMENTS; ++s) {
+		delete[] m_points[s].exchange(nullptr);
+		delete[] m_states[s].exchange(nullptr);
+	}
+	for (Stripe& stripe : m_stripes) {
+		stripe.cells.clear();
+	}
+	m_filter.clear();
+	m_reserved = 0;
+	m_live = 0;
+	m_dim = 0;
+}
+
+void ConcurrentSetImpl::locate(size_t ind, size_t& segment, size_t& offset) {
+	size_t slot = ind + SEGMENT_BASE;
+	segment = 0;
+	while ((slot >> (SEGMENT_BITS + segment + 1)) != 0) {
+		++segment;
+	}
+	offset = slot - (SEGMENT_BASE << segment);
+}
+
+double const* ConcurrentSetImpl::point(size_t ind) const {
+	size_t segment, offset;
+	locate(ind, segment, offset);
+	return m_points[segment].load(std::memory_order_acquire) + offset * m_dim.load(std::memory_order_relaxed);
+}
+
+unsigned char ConcurrentSetImpl::state(size_t ind) const {
+	size_t segment, offset;
+	locate(ind, segment, offset);
+	std::atomic<unsigned char>* states = m_states[segment].load(std::memory_order_acquire);
+	return states == nullptr ? (unsigned char)SLOT_WRITING : states[offset].load(std::memory_order_acquire);
+}
+
+size_t ConcurrentSetImpl::stripeOf(CellKey const& key) const {
+	return GridIndex::CellKeyHash()(key) % STRIPES;
+}
+
+// common checks of a tolerant query, copies its coordinates
+ReturnCode ConcurrentSetImpl::prepare(IVector const* vector, double tolerance, std::vector<double>& query) const {
+	if (vector == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	size_t dim = m_dim.load(std::memory_order_acquire);
+	if (dim != 0 && dim != vector->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	query.resize(vector->getDim());
+	return vector->getCoords(0, query.size(), query.data());
+}
+
+// the first inserted point fixes the dimension, racing first inserts agree on it
+ReturnCode ConcurrentSetImpl::setupDim(size_t dim) {
+	if (m_dim.load(std::memory_order_acquire) == 0) {
+		std::lock_guard<std::mutex> guard(m_setupLock);
+		if (m_dim.load(std::memory_order_relaxed) == 0) {
+			m_grid.reset(dim, m_tolerance);
+			if (m_filterEnabled) {
+				m_filter.reset(dim, m_tolerance, FILTER_POINTS);
+			}
+			// a failed reservation leaves the segments to be allocated by inserts
+			allocateSlots(m_reservedCount.load(), dim);
+			m_dim.store(dim, std::memory_order_release);
+		}
+	}
+
+	if (m_dim.load(std::memory_order_acquire) != dim) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+	return ReturnCode::RC_SUCCESS;
+}
+
+// stripes of the cells a match may lie in, every stripe for tolerances wider than the cells
+void ConcurrentSetImpl::collectStripes(double const* query, double tolerance, std::vector<size_t>& stripes) const {
+	stripes.clear();
+	if (tolerance > m_tolerance || std::isinf(tolerance)) {
+		for (size_t s = 0; s < STRIPES; ++s) {
+			stripes.push_back(s);
+		}
+		return;
+	}
+
+	m_grid.visitCells(query, [&](CellKey const& key) {
+		stripes.push_back(stripeOf(key));
+		return false;
+	});
+	std::sort(stripes.begin(), stripes.end());
+	stripes.erase(std::unique(stripes.begin(), stripes.end()), stripes.end());
+}
+
+void ConcurrentSetImpl::lockStripes(std::vector<size_t> const& stripes, bool exclusive) const {
+	for (size_t s : stripes) {
+		StripeLock& lock = const_cast<StripeLock&>(m_stripes[s].lock);
+		if (exclusive) {
+			lock.lock();
+		}
+		else {
+			lock.lockShared();
+		}
+	}
+}
+
+void ConcurrentSetImpl::unlockStripes(std::vector<size_t> const& stripes, bool exclusive) const {
+	for (size_t i = stripes.size(); i > 0; --i) {
+		StripeLock& lock = const_cast<StripeLock&>(m_stripes[stripes[i - 1]].lock);
+		if (exclusive) {
+			lock.unlock();
+		}
+		else {
+			lock.unlockShared();
+		}
+	}
+}
+
+// calls action(ind) for live points that may lie within the tolerance, the stripes must be locked
+template<class Action>
+void ConcurrentSetImpl::visitCandidates(double const* query, double tolerance, Action action) const {
+	if (tolerance > m_tolerance || std::isinf(tolerance)) {
+		size_t reserved = m_reserved.load(std::memory_order_acquire);
+		for (size_t i = 0; i < reserved; ++i) {
+			if (state(i) == SLOT_LIVE) {
+				action(i);
+			}
+		}
+		return;
+	}
+
+	m_grid.visitCells(query, [&](CellKey const& key) {
+		Cells const& cells = m_stripes[stripeOf(key)].cells;
+		auto cell = cells.find(key);
+		if (cell != cells.end()) {
+			for (size_t ind : cell->second) {
+				action(ind);
+			}
+		}
+		return false;
+	});
+}
+
+// storage of the segment is published once, racing threads allocate it under the grow lock
+bool ConcurrentSetImpl::allocateSegment(size_t segment, size_t dim) {
+	if (m_states[segment].load(std::memory_order_acquire) != nullptr) {
+		return true;
+	}
+
+	std::lock_guard<std::mutex> guard(m_growLock);
+	if (m_states[segment].load(std::memory_order_relaxed) == nullptr) {
+		size_t size = SEGMENT_BASE << segment;
+		double* points = new(std::nothrow) double[size * dim];
+		std::atomic<unsigned char>* states = new(std::nothrow) std::atomic<unsigned char>[size]();
+		if (points == nullptr || states == nullptr) {
+			delete[] points;
+			delete[] states;
+			return false;
+		}
+		m_points[segment].store(points, std::memory_order_release);
+		m_states[segment].store(states, std::memory_order_release);
+	}
+	return true;
+}
+
+// allocates every segment holding one of the first count slots
+bool ConcurrentSetImpl::allocateSlots(size_t count, size_t dim) {
+	if (count == 0) {
+		return true;
+	}
+
+	size_t segment, offset;
+	locate(count - 1, segment, offset);
+	if (segment >= SEGMENTS) {
+		return false;
+	}
+	for (size_t s = 0; s <= segment; ++s) {
+		if (!allocateSegment(s, dim)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// publishes a new live point, the stripe of its cell must be locked by the caller.
+// a slot is taken only once its segment exists, so a failed allocation leaves no slot behind
+ReturnCode ConcurrentSetImpl::append(double const* coords) {
+	size_t dim = m_dim.load(std::memory_order_relaxed);
+	size_t ind = m_reserved.load();
+	size_t segment, offset;
+	do {
+		locate(ind, segment, offset);
+		if (segment >= SEGMENTS) {
+			return ReturnCode::RC_NO_MEM;
+		}
+
+		if (!allocateSegment(segment, dim)) {
+			return ReturnCode::RC_NO_MEM;
+		}
+	} while (!m_reserved.compare_exchange_weak(ind, ind + 1));
+
+	double* target = m_points[segment].load(std::memory_order_acquire) + offset * dim;
+	for (size_t i = 0; i < dim; ++i) {
+		target[i] = coords[i];
+	}
+	CellKey key = m_grid.key(target);
+	m_stripes[stripeOf(key)].cells[key].push_back(ind);
+	m_filter.add(target);
+	m_states[segment].load(std::memory_order_relaxed)[offset].store(SLOT_LIVE, std::memory_order_release);
+	++m_live;
+	return ReturnCode::RC_SUCCESS;
+}
+
+// turns a live point into a tombstone, the stripe of its cell must be locked by the caller
+void ConcurrentSetImpl::kill(size_t ind) {
+	size_t segment, offset;
+	locate(ind, segment, offset);
+	if (m_states[segment].load(std::memory_order_relaxed)[offset].exchange(SLOT_ERASED) != SLOT_LIVE) {
+		return;
+	}
+
+	CellKey key = m_grid.key(point(ind));
+	Cells& cells = m_stripes[stripeOf(key)].cells;
+	auto cell = cells.find(key);
+	if (cell != cells.end()) {
+		std::vector<size_t>& inds = cell->second;
+		for (size_t i = 0; i < inds.size(); ++i) {
+			if (inds[i] == ind) {
+				inds[i] = inds.back();
+				inds.pop_back();
+				break;
+			}
+		}
+		if (inds.empty()) {
+			cells.erase(cell);
+		}
+	}
+	--m_live;
+}
+
+ReturnCode ConcurrentSetImpl::insert(IVector const* vector, IVector::Norm norm, double tolerance) {
+	std::vector<double> query;
+	ReturnCode rc = prepare(vector, tolerance, query);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		return rc;
+	}
+
+	rc = setupDim(query.size());
+	if (rc != ReturnCode::RC_SUCCESS) {
+		return rc;
+	}
+
+	size_t dim = query.size();
+	std::vector<size_t> stripes;
+	collectStripes(query.data(), tolerance, stripes);
+	lockStripes(stripes, true);
+
+	// inserts of close points lock a common stripe, so bits of an earlier one are visible here
+	std::vector<size_t> matches;
+	bool kept = true;
+	if (!m_filterEnabled || tolerance > m_tolerance || m_filter.mayContain(query.data())) {
+		visitCandidates(query.data(), tolerance, [&](size_t ind) {
+			if (pointDistance(point(ind), query.data(), dim, norm) < tolerance) {
+				matches.push_back(ind);
+				kept = kept && lexicographicallyLess(query.data(), point(ind), dim);
+			}
+		});
+	}
+
+	if (kept) {
+		for (size_t ind : matches) {
+			kill(ind);
+		}
+		rc = append(query.data());
+	}
+
+	unlockStripes(stripes, true);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(m_logger, rc);
+	}
+	return rc;
+}
+
+ReturnCode ConcurrentSetImpl::erase(size_t index) {
+	if (index >= m_reserved.load(std::memory_order_acquire)) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	if (state(index) != SLOT_LIVE) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	std::vector<size_t> stripes(1, stripeOf(m_grid.key(point(index))));
+	lockStripes(stripes, true);
+	bool live = state(index) == SLOT_LIVE;
+	if (live) {
+		kill(index);
+	}
+	unlockStripes(stripes, true);
+
+	return live ? ReturnCode::RC_SUCCESS : ReturnCode::RC_ELEM_NOT_FOUND;
+}
+
+ReturnCode ConcurrentSetImpl::erase(IVector const* vector, IVector::Norm norm, double tolerance) {
+	std::vector<double> query;
+	ReturnCode rc = prepare(vector, tolerance, query);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		return rc;
+	}
+
+	size_t dim = query.size();
+	if (m_dim.load(std::memory_order_acquire) == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	std::vector<size_t> stripes;
+	collectStripes(query.data(), tolerance, stripes);
+	lockStripes(stripes, true);
+
+	std::vector<size_t> matches;
+	visitCandidates(query.data(), tolerance, [&](size_t ind) {
+		if (pointDistance(point(ind), query.data(), dim, norm) < tolerance) {
+			matches.push_back(ind);
+		}
+	});
+	for (size_t ind : matches) {
+		kill(ind);
+	}
+
+	unlockStripes(stripes, true);
+	return matches.empty() ? ReturnCode::RC_ELEM_NOT_FOUND : ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode ConcurrentSetImpl::eraseAll(ISet const* other, IVector::Norm norm, double tolerance) {
+	if (other == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (getSize() == 0 || other->getSize() == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	size_t dim = m_dim.load(std::memory_order_acquire);
+	if (dim != other->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	if (tolerance <= 0.0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	PointsView view;
+	view.init(other);
+	GridIndex index;
+	index.reset(dim, tolerance);
+	for (size_t i = 0; i < view.getCount(); ++i) {
+		index.add(view.point(i), i);
+	}
+
+	std::vector<size_t> stripes;
+	collectStripes(nullptr, INFINITY, stripes);
+	lockStripes(stripes, true);
+
+	bool found = false;
+	size_t reserved = m_reserved.load(std::memory_order_acquire);
+	for (size_t i = 0; i < reserved; ++i) {
+		if (state(i) != SLOT_LIVE) {
+			continue;
+		}
+		double const* p = point(i);
+		bool match = index.visit(p, [&](size_t candidate) {
+			return pointDistance(p, view.point(candidate), dim, norm) < tolerance;
+		});
+		if (match) {
+			kill(i);
+			found = true;
+		}
+	}
+
+	unlockStripes(stripes, true);
+	return found ? ReturnCode::RC_SUCCESS : ReturnCode::RC_ELEM_NOT_FOUND;
+}
+
+ReturnCode ConcurrentSetImpl::get(IVector*& dst, size_t ind) const {
+	if (ind >= m_reserved.load(std::memory_order_acquire)) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	if (state(ind) != SLOT_LIVE) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	dst = IVector::createVector(m_dim.load(std::memory_order_relaxed), const_cast<double*>(point(ind)), m_logger);
+	return dst != nullptr ? ReturnCode::RC_SUCCESS : ReturnCode::RC_NO_MEM;
+}
+
+ReturnCode ConcurrentSetImpl::find(IVector const* vector, IVector::Norm norm, double tolerance, size_t& ind) const {
+	std::vector<double> query;
+	ReturnCode rc = prepare(vector, tolerance, query);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		return rc;
+	}
+
+	size_t dim = query.size();
+	if (m_dim.load(std::memory_order_acquire) == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	// definite misses take no locks
+	if (m_filterEnabled && tolerance <= m_tolerance && !m_filter.mayContain(query.data())) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	std::vector<size_t> stripes;
+	collectStripes(query.data(), tolerance, stripes);
+	lockStripes(stripes, false);
+
+	// the first stored match is reported
+	bool found = false;
+	visitCandidates(query.data(), tolerance, [&](size_t candidate) {
+		if ((!found || candidate < ind) &&
+			pointDistance(point(candidate), query.data(), dim, norm) < tolerance) {
+			ind = candidate;
+			found = true;
+		}
+	});
+
+	unlockStripes(stripes, false);
+	return found ? ReturnCode::RC_SUCCESS : ReturnCode::RC_ELEM_NOT_FOUND;
+}
+
+// nearest and radius queries scan the whole set under shared locks of every stripe
+ReturnCode ConcurrentSetImpl::findNearest(IVector const* vector, IVector::Norm norm, size_t k, std::vector<size_t>& inds) const {
+	inds.clear();
+	std::vector<double> query;
+	ReturnCode rc = prepare(vector, 0.0, query);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		return rc;
+	}
+
+	size_t dim = query.size();
+	if (m_dim.load(std::memory_order_acquire) == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	std::vector<size_t> stripes;
+	collectStripes(nullptr, INFINITY, stripes);
+	lockStripes(stripes, false);
+
+	std::vector<std::pair<double, size_t>> distances;
+	visitCandidates(nullptr, INFINITY, [&](size_t ind) {
+		distances.push_back(std::make_pair(pointDistance(point(ind), query.data(), dim, norm), ind));
+	});
+
+	unlockStripes(stripes, false);
+
+	if (k > distances.size()) {
+		k = distances.size();
+	}
+	std::partial_sort(distances.begin(), distances.begin() + k, distances.end());
+	inds.resize(k);
+	for (size_t i = 0; i < k; ++i) {
+		inds[i] = distances[i].second;
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode ConcurrentSetImpl::findInRadius(IVector const* vector, IVector::Norm norm, double radius, std::vector<size_t>& inds) const {
+	inds.clear();
+	std::vector<double> query;
+	ReturnCode rc = prepare(vector, radius, query);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		return rc;
+	}
+
+	size_t dim = query.size();
+	if (m_dim.load(std::memory_order_acquire) == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	std::vector<size_t> stripes;
+	collectStripes(nullptr, INFINITY, stripes);
+	lockStripes(stripes, false);
+
+	visitCandidates(nullptr, INFINITY, [&](size_t ind) {
+		if (pointDistance(point(ind), query.data(), dim, norm) <= radius) {
+			inds.push_back(ind);
+		}
+	});
+
+	unlockStripes(stripes, false);
+	return ReturnCode::RC_SUCCESS;
+}
+
+// points of concurrent inserts may or may not be seen
+ReturnCode ConcurrentSetImpl::forEach(Visitor& visitor) const {
+	size_t reserved = m_reserved.load(std::memory_order_acquire);
+	for (size_t i = 0; i < reserved; ++i) {
+		if (state(i) == SLOT_LIVE && !visitor.visit(i, point(i))) {
+			break;
+		}
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+// a block is a run of live points within one segment
+ReturnCode ConcurrentSetImpl::getBlock(size_t& cursor, double const*& block, size_t& count) const {
+	block = nullptr;
+	count = 0;
+	size_t reserved = m_reserved.load(std::memory_order_acquire);
+	while (cursor < reserved && state(cursor) != SLOT_LIVE) {
+		++cursor;
+	}
+	if (cursor >= reserved) {
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	size_t segment, offset;
+	locate(cursor, segment, offset);
+	size_t segmentEnd = cursor + (SEGMENT_BASE << segment) - offset;
+	block = point(cursor);
+	while (cursor < reserved && cursor < segmentEnd && state(cursor) == SLOT_LIVE) {
+		++cursor;
+		++count;
+	}
+	return ReturnCode::RC_SUCCESS;
+}
+
+size_t ConcurrentSetImpl::getDim() const {
+	return m_dim.load(std::memory_order_acquire);
+}
+
+size_t ConcurrentSetImpl::getSize() const {
+	return m_live.load(std::memory_order_acquire);
+}
+
+ISet* ConcurrentSetImpl::clone() const {
+	ConcurrentSetImpl* set = new(std::nothrow) ConcurrentSetImpl(m_tolerance);
+	if (set == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NO_MEM);
+		return nullptr;
+	}
+
+	std::vector<size_t> stripes;
+	collectStripes(nullptr, INFINITY, stripes);
+	lockStripes(stripes, false);
+
+	ReturnCode rc = ReturnCode::RC_SUCCESS;
+	size_t dim = m_dim.load(std::memory_order_acquire);
+	set->m_filterEnabled = m_filterEnabled;
+	if (dim != 0) {
+		set->setupDim(dim);
+		size_t reserved = m_reserved.load(std::memory_order_acquire);
+		for (size_t i = 0; i < reserved && rc == ReturnCode::RC_SUCCESS; ++i) {
+			if (state(i) == SLOT_LIVE) {
+				rc = set->append(point(i));
+			}
+		}
+	}
+
+	unlockStripes(stripes, false);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(m_logger, rc);
+		delete set;
+		return nullptr;
+	}
+	return set;
+}
+
+void ConcurrentSetImpl::clear() {
+	release();
+}
+
+// slot numbers have to stay valid while other threads work with the set
+ReturnCode ConcurrentSetImpl::setEraseMode(EraseMode mode) {
+	if (mode != EraseMode::EM_TOMBSTONE) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+void ConcurrentSetImpl::compact() {
+	size_t dim = m_dim.load();
+	if (m_live.load() == m_reserved.load()) {
+		return;
+	}
+
+	std::vector<double> points;
+	points.reserve(m_live.load() * dim);
+	size_t reserved = m_reserved.load();
+	for (size_t i = 0; i < reserved; ++i) {
+		if (state(i) == SLOT_LIVE) {
+			points.insert(points.end(), point(i), point(i) + dim);
+		}
+	}
+
+	release();
+	if (points.empty()) {
+		return;
+	}
+	setupDim(dim);
+	if (m_filterEnabled) {
+		m_filter.reset(dim, m_tolerance, std::max(FILTER_POINTS, 2 * points.size() / dim));
+	}
+	for (size_t i = 0; i < points.size(); i += dim) {
+		append(points.data() + i);
+	}
+}
+
+// the filter is sized for twice the live points and filled from them
+ReturnCode ConcurrentSetImpl::setFilter(bool enabled) {
+	m_filterEnabled = enabled;
+	m_filter.clear();
+	size_t dim = m_dim.load();
+	if (!enabled || dim == 0) {
+		return ReturnCode::RC_SUCCESS;
+	}
+
+	if (!m_filter.reset(dim, m_tolerance, std::max(FILTER_POINTS, 2 * m_live.load()))) {
+		LOG(m_logger, ReturnCode::RC_NO_MEM);
+		return ReturnCode::RC_NO_MEM;
+	}
+	size_t reserved = m_reserved.load();
+	for (size_t i = 0; i < reserved; ++i) {
+		if (state(i) == SLOT_LIVE) {
+			m_filter.add(point(i));
+		}
+	}
+	return ReturnCode::RC_SUCCESS;
+}
+
+// slot numbers have to stay valid while other threads work with the set
+ReturnCode ConcurrentSetImpl::reorder(double) {
+	LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+	return ReturnCode::RC_INVALID_PARAMS;
+}
+
+ReturnCode ConcurrentSetImpl::setSpatialOrder(double cellSize) {
+	if (cellSize == 0.0) {
+		return ReturnCode::RC_SUCCESS;
+	}
+
+	LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+	return ReturnCode::RC_INVALID_PARAMS;
+}
+
+// segments never move, so reserved slots are allocated at once and other threads may keep inserting
+ReturnCode ConcurrentSetImpl::reserve(size_t count) {
+	size_t dim = m_dim.load(std::memory_order_acquire);
+	if (dim == 0) {
+		m_reservedCount = count;
+		return ReturnCode::RC_SUCCESS;
+	}
+
+	if (!allocateSlots(count, dim)) {
+		LOG(m_logger, ReturnCode::RC_NO_MEM);
+		return ReturnCode::RC_NO_MEM;
+	}
+	return ReturnCode::RC_SUCCESS;
+}
+
+// frees the segments past the last used slot and trims the cell tables, needs exclusive use of the set
+void ConcurrentSetImpl::shrinkToFit() {
+	m_reservedCount = 0;
+	size_t reserved = m_reserved.load();
+	size_t used = 0;
+	if (reserved != 0) {
+		size_t offset;
+		locate(reserved - 1, used, offset);
+		++used;
+	}
+	for (size_t s = used; s < SEGMENTS; ++s) {
+		delete[] m_points[s].exchange(nullptr);
+		delete[] m_states[s].exchange(nullptr);
+	}
+
+	for (Stripe& stripe : m_stripes) {
+		for (auto& cell : stripe.cells) {
+			cell.second.shrink_to_fit();
+		}
+		stripe.cells.rehash(0);
+	}
+}
+
+void ConcurrentSetImpl::getMemoryUsage(MemoryUsage& usage) const {
+	size_t dim = m_dim.load(std::memory_order_acquire);
+	usage.points = 0;
+	usage.index = m_filter.memoryUsage() + m_stripes.capacity() * sizeof(Stripe);
+	usage.overhead = sizeof(*this);
+	for (size_t s = 0; s < SEGMENTS; ++s) {
+		if (m_states[s].load(std::memory_order_acquire) != nullptr) {
+			usage.points += (SEGMENT_BASE << s) * dim * sizeof(double);
+			usage.overhead += (SEGMENT_BASE << s) * sizeof(std::atomic<unsigned char>);
+		}
+	}
+
+	std::vector<size_t> stripes;
+	collectStripes(nullptr, INFINITY, stripes);
+	lockStripes(stripes, false);
+	for (Stripe const& stripe : m_stripes) {
+		usage.index += hashMapMemory(stripe.cells);
+	}
+	unlockStripes(stripes, false);
+}
@@ -0,0 +1,274 @@
+#ifndef GRID_INDEX_H
+#define GRID_INDEX_H
+
+#include <cstddef>		 // size_t
+#include <cmath>		 // floor, isinf
+#include <vector>		 // vector
+#include <utility>		 // pair
+#include <algorithm>	 // stable_sort
+#include <unordered_map> // unordered_map
+
+namespace {
+	/* declaration */
+	// uniform grid over the first few coordinates, cells are at least as wide as the tolerance.
+	// points closer than the tolerance in any norm are closer than it in every coordinate,
+	// so they differ by at most one cell per coordinate and only 3^keyDim neighbour cells are probed.
+	// the index stores point numbers only, callers verify candidates against their own storage.
+	class GridIndex {
+	public:
+		static size_t const MAX_KEY_DIM = 4;
+
+		GridIndex() = default;
+
+		void reset(size_t dim, double tolerance);
+		void clear();
+		bool suits(double tolerance) const;
+
+		void add(double const* point, size_t ind);
+		void remove(double const* point, size_t ind);
+		void relabel(double const* point, size_t from, size_t to);
+		// numbers from first on grow by one, making room for a point inserted at first
+		void shift(size_t first);
+
+		// calls action(ind) for every point in the neighbour cells until it returns true
+		template<class Action>
+		bool visit(double const* point, Action action) const;
+		// calls action(key) for the cell of the point and its neighbours until it returns true
+		template<class Action>
+		bool visitCells(double const* point, Action action) const;
+
+		struct CellKey {
+			long long coord[MAX_KEY_DIM];
+
+			bool operator==(CellKey const& other) const {
+				for (size_t i = 0; i < MAX_KEY_DIM; ++i) {
+					if (coord[i] != other.coord[i])
+						return false;
+				}
+				return true;
+			}
+		};
+
+		struct CellKeyHash {
+			size_t operator()(CellKey const& key) const {
+				unsigned long long hash = 1469598103934665603ULL;
+				for (size_t i = 0; i < MAX_KEY_DIM; ++i) {
+					hash ^= (unsigned long long)key.coord[i];
+					hash *= 1099511628211ULL;
+				}
+				return (size_t)(hash ^ (hash >> 32));
+			}
+		};
+
+		CellKey key(double const* point) const;
+		// heap bytes held by the cells
+		size_t memoryUsage() const;
+		// Z-order of cells, neighbouring cells mostly end up close in it
+		static bool mortonLess(CellKey const& a, CellKey const& b);
+		// sorts numbers of row-major points stably by the Z-order of their cells
+		void mortonSort(double const* points, size_t dim, std::vector<size_t>& inds) const;
+		// first of count points sorted by mortonSort whose cell follows the cell of the point
+		size_t mortonUpperBound(double const* points, size_t dim, size_t count, double const* point) const;
+
+	private:
+		size_t m_keyDim {0};
+		double m_cell {0.0};
+		std::unordered_map<CellKey, std::vector<size_t>, CellKeyHash> m_cells;
+	};
+}
+
+/* implementation */
+// heap bytes of a hash table of index lists, every node is counted with two pointers of overhead
+template<class Map>
+static size_t hashMapMemory(Map const& map) {
+	size_t bytes = map.bucket_count() * sizeof(void*);
+	for (auto const& entry : map) {
+		bytes += sizeof(entry) + 2 * sizeof(void*) + entry.second.capacity() * sizeof(entry.second[0]);
+	}
+	return bytes;
+}
+
+// widening the cells a little keeps rounding of the quantization from splitting close points
+// more than one cell apart
+static double const GRID_CELL_MARGIN = 1.0 + 1e-6;
+// keeps quantized coordinates away from long long overflow
+static double const GRID_KEY_LIMIT = 4.0e18;
+
+size_t const GridIndex::MAX_KEY_DIM;
+
+void GridIndex::reset(size_t dim, double tolerance) {
+	m_cells.clear();
+	m_keyDim = dim < MAX_KEY_DIM ? dim : MAX_KEY_DIM;
+	m_cell = tolerance * GRID_CELL_MARGIN;
+}
+
+void GridIndex::clear() {
+	m_cells.clear();
+	m_keyDim = 0;
+	m_cell = 0.0;
+}
+
+// coarser cells stay correct but bring more candidates, so the index is rebuilt
+// once the tolerance drops well below the cell size
+bool GridIndex::suits(double tolerance) const {
+	return m_keyDim != 0 && tolerance > 0.0 && tolerance <= m_cell && tolerance * 4.0 >= m_cell;
+}
+
+GridIndex::CellKey GridIndex::key(double const* point) const {
+	CellKey key;
+	for (size_t i = 0; i < MAX_KEY_DIM; ++i) {
+		double q = 0.0;
+		if (i < m_keyDim && !std::isinf(m_cell)) {
+			q = std::floor(point[i] / m_cell);
+			if (q > GRID_KEY_LIMIT)
+				q = GRID_KEY_LIMIT;
+			if (q < -GRID_KEY_LIMIT)
+				q = -GRID_KEY_LIMIT;
+		}
+		key.coord[i] = (long long)q;
+	}
+	return key;
+}
+
+// compares the cells by the coordinate holding the highest differing bit,
+// which orders them as interleaved bits would without building the codes
+bool GridIndex::mortonLess(CellKey const& a, CellKey const& b) {
+	unsigned long long const SIGN = 1ULL << 63;
+	size_t top = 0;
+	unsigned long long topBits = 0;
+	for (size_t i = 0; i < MAX_KEY_DIM; ++i) {
+		unsigned long long bits = (unsigned long long)a.coord[i] ^ (unsigned long long)b.coord[i];
+		if (topBits < bits && topBits < (topBits ^ bits)) {
+			top = i;
+			topBits = bits;
+		}
+	}
+	return ((unsigned long long)a.coord[top] ^ SIGN) < ((unsigned long long)b.coord[top] ^ SIGN);
+}
+
+size_t GridIndex::memoryUsage() const {
+	return hashMapMemory(m_cells);
+}
+
+void GridIndex::mortonSort(double const* points, size_t dim, std::vector<size_t>& inds) const {
+	std::vector<std::pair<CellKey, size_t>> keyed(inds.size());
+	for (size_t i = 0; i < inds.size(); ++i) {
+		keyed[i] = std::make_pair(key(points + inds[i] * dim), inds[i]);
+	}
+	std::stable_sort(keyed.begin(), keyed.end(), [](std::pair<CellKey, size_t> const& a, std::pair<CellKey, size_t> const& b) {
+		return mortonLess(a.first, b.first);
+	});
+	for (size_t i = 0; i < inds.size(); ++i) {
+		inds[i] = keyed[i].second;
+	}
+}
+
+size_t GridIndex::mortonUpperBound(double const* points, size_t dim, size_t count, double const* point) const {
+	CellKey target = key(point);
+	size_t first = 0;
+	while (count > 0) {
+		size_t half = count / 2;
+		if (mortonLess(target, key(points + (first + half) * dim))) {
+			count = half;
+		}
+		else {
+			first += half + 1;
+			count -= half + 1;
+		}
+	}
+	return first;
+}
+
+void GridIndex::add(double const* point, size_t ind) {
+	m_cells[key(point)].push_back(ind);
+}
+
+void GridIndex::remove(double const* point, size_t ind) {
+	auto cell = m_cells.find(key(point));
+	if (cell == m_cells.end()) {
+		return;
+	}
+	std::vector<size_t>& inds = cell->second;
+	for (size_t i = 0; i < inds.size(); ++i) {
+		if (inds[i] == ind) {
+			inds[i] = inds.back();
+			inds.pop_back();
+			break;
+		}
+	}
+	if (inds.empty()) {
+		m_cells.erase(cell);
+	}
+}
+
+void GridIndex::relabel(double const* point, size_t from, size_t to) {
+	auto cell = m_cells.find(key(point));
+	if (cell == m_cells.end()) {
+		return;
+	}
+	for (size_t& ind : cell->second) {
+		if (ind == from) {
+			ind = to;
+			return;
+		}
+	}
+}
+
+void GridIndex::shift(size_t first) {
+	for (auto& cell : m_cells) {
+		for (size_t& ind : cell.second) {
+			if (ind >= first)
+				++ind;
+		}
+	}
+}
+
+template<class Action>
+bool GridIndex::visit(double const* point, Action action) const {
+	if (m_cells.empty()) {
+		return false;
+	}
+
+	return visitCells(point, [&](CellKey const& neighbour) {
+		auto cell = m_cells.find(neighbour);
+		if (cell != m_cells.end()) {
+			for (size_t ind : cell->second) {
+				if (action(ind))
+					return true;
+			}
+		}
+		return false;
+	});
+}
+
+template<class Action>
+bool GridIndex::visitCells(double const* point, Action action) const {
+	CellKey center = key(point);
+	// odometer over offsets {-1, 0, 1} of every key coordinate
+	int offset[MAX_KEY_DIM] = {-1, -1, -1, -1};
+	for (size_t i = m_keyDim; i < MAX_KEY_DIM; ++i) {
+		offset[i] = 0;
+	}
+	for (;;) {
+		CellKey neighbour = center;
+		for (size_t i = 0; i < m_keyDim; ++i) {
+			neighbour.coord[i] += offset[i];
+		}
+		if (action(neighbour)) {
+			return true;
+		}
+
+		size_t i = 0;
+		while (i < m_keyDim && offset[i] == 1) {
+			offset[i] = -1;
+			++i;
+		}
+		if (i == m_keyDim) {
+			break;
+		}
+		++offset[i];
+	}
+	return false;
+}
+
+#endif /* GRID_INDEX_H */
@@ -1,7 +1,15 @@
 #include "../include/ISet.h"
 #include "SetImpl.cpp"
-#include <new>   // nothrow
-#include <cmath> // nan, isnan
+#include "KDTreeSetImpl.cpp"
+#include "ConcurrentSetImpl.cpp"
+#include "MappedSetImpl.cpp"
+#include "SetCursorImpl.cpp"
+#include "SlabProbe.h"
+#include <new>		 // nothrow
+#include <cmath>	 // nan, isnan
+#include <vector>	 // vector
+#include <cstring>	 // memcpy
+#include <stdio.h>	 // FILE, fopen, fwrite
 
 static ReturnCode checkData(ISet const* set1, ISet const* set2, double tolerance) {
 	if (set1 == nullptr || set2 == nullptr) {
@@ -27,8 +35,32 @@ static ReturnCode checkData(ISet const* set1, ISet const* set2, double tolerance
 	return ReturnCode::RC_SUCCESS;
 }
 
+static ReturnCode checkData(ISet::Cursor const* source, ISet const* set, double tolerance) {
+	if (source == nullptr || set == nullptr) {
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (source->getDim() != set->getDim()) {
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	if (std::isnan(tolerance)) {
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
 ISet::~ISet() {}
 
+ISet::Visitor::~Visitor() {}
+
+ISet::Cursor::~Cursor() {}
+
 ISet* ISet::createSet(ILogger* logger) {
 	ISet* set = new(std::nothrow) SetImpl();
 	if (set == nullptr) {
@@ -39,6 +71,262 @@ ISet* ISet::createSet(ILogger* logger) {
 	return set;
 }
 
+ISet* ISet::createKDTreeSet(ILogger* logger) {
+	ISet* set = new(std::nothrow) KDTreeSetImpl();
+	if (set == nullptr) {
+		LOG(logger, ReturnCode::RC_NO_MEM);
+		return nullptr;
+	}
+
+	return set;
+}
+
+// the result owns the points from the buffer, the buffer is left empty
+static ISet* createFromPoints(size_t dim, std::vector<double>& points, ILogger* logger, double tolerance = 0.0) {
+	SetImpl* set = new(std::nothrow) SetImpl();
+	if (set == nullptr) {
+		LOG(logger, ReturnCode::RC_NO_MEM);
+		return nullptr;
+	}
+
+	set->assign(dim, points, tolerance);
+	return set;
+}
+
+// copies the points of the view whose flag equals keep
+static void selectPoints(PointsView const& view, std::vector<bool> const& marked, bool keep, std::vector<double>& points) {
+	size_t dim = view.getDim();
+	for (size_t i = 0; i < view.getCount(); ++i) {
+		if (marked[i] == keep) {
+			points.insert(points.end(), view.point(i), view.point(i) + dim);
+		}
+	}
+}
+
+// byte flags, unlike vector<bool>, may be set by several threads at once
+static void selectPoints(PointsView const& view, std::vector<char> const& marked, bool keep, std::vector<double>& points) {
+	size_t dim = view.getDim();
+	for (size_t i = 0; i < view.getCount(); ++i) {
+		if ((marked[i] != 0) == keep) {
+			points.insert(points.end(), view.point(i), view.point(i) + dim);
+		}
+	}
+}
+
+ISet* ISet::createConcurrentSet(double tolerance, ILogger* logger) {
+	if (std::isnan(tolerance)) {
+		LOG(logger, ReturnCode::RC_NAN);
+		return nullptr;
+	}
+
+	if (!(tolerance > 0.0) || std::isinf(tolerance)) {
+		LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+		return nullptr;
+	}
+
+	ISet* set = new(std::nothrow) ConcurrentSetImpl(tolerance);
+	if (set == nullptr) {
+		LOG(logger, ReturnCode::RC_NO_MEM);
+		return nullptr;
+	}
+
+	return set;
+}
+
+ISet* ISet::createLSHSet(LSHParams const& params, ILogger* logger) {
+	if (params.tables == 0 || params.projections == 0 || !(params.width > 0.0) || std::isinf(params.width)) {
+		LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+		return nullptr;
+	}
+
+	SetImpl* set = new(std::nothrow) SetImpl();
+	if (set == nullptr) {
+		LOG(logger, ReturnCode::RC_NO_MEM);
+		return nullptr;
+	}
+
+	set->useLSH(params);
+	return set;
+}
+
+ReturnCode ISet::getLSHStats(ISet const* set, LSHStats& stats, ILogger* logger) {
+	if (set == nullptr) {
+		LOG(logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	SetImpl const* impl = dynamic_cast<SetImpl const*>(set);
+	if (impl == nullptr || !impl->usesLSH()) {
+		LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	impl->getLSHStats(stats);
+	return ReturnCode::RC_SUCCESS;
+}
+
+// duplicates are dropped in input order through a grid, then the kept points are sorted
+// by their cells in Z-order, so the whole load costs O(n log n)
+ISet* ISet::createSet(size_t dim, size_t count, double const* points, IVector::Norm norm, double tolerance, ILogger* logger) {
+	if (points == nullptr && count != 0) {
+		LOG(logger, ReturnCode::RC_NULL_PTR);
+		return nullptr;
+	}
+
+	if (dim == 0) {
+		LOG(logger, ReturnCode::RC_ZERO_DIM);
+		return nullptr;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(logger, ReturnCode::RC_NAN);
+		return nullptr;
+	}
+
+	if (tolerance < 0) {
+		LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+		return nullptr;
+	}
+
+	std::vector<double> kept;
+	if (count > kept.max_size() / dim) {
+		LOG(logger, ReturnCode::RC_NO_MEM);
+		return nullptr;
+	}
+
+	// no set holds nan coordinates, as no vector does
+	for (size_t i = 0; i < count * dim; ++i) {
+		if (std::isnan(points[i])) {
+			LOG(logger, ReturnCode::RC_NAN);
+			return nullptr;
+		}
+	}
+
+	if (tolerance <= 0.0) {
+		kept.assign(points, points + count * dim);
+		return createFromPoints(dim, kept, logger);
+	}
+
+	GridIndex index;
+	index.reset(dim, tolerance);
+	std::vector<size_t> order;
+	order.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		double const* p = points + i * dim;
+		bool found = index.visit(p, [&](size_t candidate) {
+			return pointDistance(points + candidate * dim, p, dim, norm) < tolerance;
+		});
+		if (!found) {
+			index.add(p, i);
+			order.push_back(i);
+		}
+	}
+
+	index.mortonSort(points, dim, order);
+
+	kept.reserve(order.size() * dim);
+	for (size_t i : order) {
+		kept.insert(kept.end(), points + i * dim, points + (i + 1) * dim);
+	}
+
+	return createFromPoints(dim, kept, logger, tolerance);
+}
+
+// the grid is built here once, so loading only maps the file.
+// points are grouped by cells in Z-order and the cell table is sorted the same way
+ReturnCode ISet::saveSet(ISet const* set, char const* fileName, double tolerance, ILogger* logger) {
+	if (set == nullptr || fileName == nullptr) {
+		LOG(logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (set->getDim() == 0) {
+		LOG(logger, ReturnCode::RC_ZERO_DIM);
+		return ReturnCode::RC_ZERO_DIM;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	PointsView view;
+	view.init(set);
+	size_t dim = view.getDim();
+	size_t count = view.getCount();
+
+	std::vector<SetFileCell> cells;
+	std::vector<uint64_t> order;
+	if (tolerance > 0.0) {
+		GridIndex index;
+		index.reset(dim, tolerance);
+		std::vector<size_t> sorted(count);
+		for (size_t i = 0; i < count; ++i) {
+			sorted[i] = i;
+		}
+		index.mortonSort(view.point(0), dim, sorted);
+
+		order.reserve(count);
+		GridIndex::CellKey last = GridIndex::CellKey();
+		for (size_t i : sorted) {
+			GridIndex::CellKey key = index.key(view.point(i));
+			if (cells.empty() || !(key == last)) {
+				SetFileCell cell;
+				for (size_t j = 0; j < GridIndex::MAX_KEY_DIM; ++j) {
+					cell.coord[j] = (int64_t)key.coord[j];
+				}
+				cell.first = order.size();
+				cell.count = 0;
+				cells.push_back(cell);
+				last = key;
+			}
+			++cells.back().count;
+			order.push_back(i);
+		}
+	}
+
+	FILE* file = fopen(fileName, "wb");
+	if (file == NULL) {
+		LOG(logger, ReturnCode::RC_OPEN_FILE);
+		return ReturnCode::RC_OPEN_FILE;
+	}
+
+	SetFileHeader header;
+	std::memcpy(header.magic, SET_FILE_MAGIC, sizeof(SET_FILE_MAGIC));
+	header.version = SET_FILE_VERSION;
+	header.dim = dim;
+	header.count = count;
+	header.tolerance = tolerance;
+	header.cellCount = cells.size();
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+				   fwrite(view.point(0), sizeof(double) * dim, count, file) == count &&
+				   fwrite(cells.data(), sizeof(SetFileCell), cells.size(), file) == cells.size() &&
+				   fwrite(order.data(), sizeof(uint64_t), order.size(), file) == order.size();
+
+	if (fclose(file) != 0 || !written) {
+		LOG(logger, ReturnCode::RC_OPEN_FILE);
+		return ReturnCode::RC_OPEN_FILE;
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+ISet* ISet::createMappedSet(char const* fileName, ILogger* logger) {
+	if (fileName == nullptr) {
+		LOG(logger, ReturnCode::RC_NULL_PTR);
+		return nullptr;
+	}
+
+	return MappedSetImpl::createFromFile(fileName, logger);
+}
+
+// the result starts as a copy of set1, points of set2 are appended unless the grid
+// over the result already holds a match, so the pass costs O(n + m) expected
 ISet* ISet::_union(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger) {
 	ReturnCode rc = checkData(set1, set2, tolerance);
 	if (rc != ReturnCode::RC_SUCCESS) {
@@ -46,19 +334,38 @@ ISet* ISet::_union(ISet const* set1, ISet const* set2, IVector::Norm norm, doubl
 		return nullptr;
 	}
 
-	ISet* result = set1->clone();
-	IVector* vec = nullptr;
-	rc = ReturnCode::RC_SUCCESS;
-	for (size_t i = 0; rc != ReturnCode::RC_OUT_OF_BOUNDS; ++i) {
-		rc = set2->get(vec, i);
-		if (vec != nullptr) {
-			result->insert(vec, norm, tolerance);
-			delete vec;
-			vec = nullptr;
+	PointsView view1, view2;
+	view1.init(set1);
+	view2.init(set2);
+	size_t dim = view1.getDim();
+
+	std::vector<double> points;
+	points.reserve((view1.getCount() + view2.getCount()) * dim);
+	points.assign(view1.point(0), view1.point(0) + view1.getCount() * dim);
+
+	if (tolerance <= 0.0) {
+		points.insert(points.end(), view2.point(0), view2.point(0) + view2.getCount() * dim);
+		return createFromPoints(dim, points, logger);
+	}
+
+	GridIndex index;
+	index.reset(dim, tolerance);
+	for (size_t i = 0; i < view1.getCount(); ++i) {
+		index.add(view1.point(i), i);
+	}
+	for (size_t j = 0; j < view2.getCount(); ++j) {
+		double const* q = view2.point(j);
+		bool found = index.visit(q, [&](size_t candidate) {
+			return pointDistance(points.data() + candidate * dim, q, dim, norm) < tolerance;
+		});
+		if (!found) {
+			size_t ind = points.size() / dim;
+			points.insert(points.end(), q, q + dim);
+			index.add(points.data() + ind * dim, ind);
 		}
 	}
 
-	return result;
+	return createFromPoints(dim, points, logger);
 }
 
 ISet* ISet::difference(ISet const* minuend, ISet const* subtrahend, IVector::Norm norm, double tolerance, ILogger* logger) {
@@ -68,21 +375,21 @@ ISet* ISet::difference(ISet const* minuend, ISet const* subtrahend, IVector::Nor
 		return nullptr;
 	}
 
-	ISet* result = minuend->clone();
-	IVector* vec = nullptr;
-	rc = ReturnCode::RC_SUCCESS;
-	for (size_t i = 0; rc != ReturnCode::RC_OUT_OF_BOUNDS; ++i) {
-		rc = subtrahend->get(vec, i);
-		if (vec != nullptr) {
-			result->erase(vec, norm, tolerance);
-			delete vec;
-			vec = nullptr;
-		}
-	}
+	PointsView view1, view2;
+	view1.init(minuend);
+	view2.init(subtrahend);
 
-	return result;
+	std::vector<bool> marked;
+	markMatches(view1.point(0), view1.getCount(), view2, norm, tolerance, marked);
+	std::vector<double> points;
+	selectPoints(view1, marked, false, points);
+
+	return createFromPoints(view1.getDim(), points, logger);
 }
 
+// points of set1 without a match in set2 followed by points of set2 without a match in set1,
+// both operands are classified by one indexed pass. as in _union, a point of set2 matching
+// an earlier kept point of set2 is dropped, points of set1 are kept as they are
 ISet* ISet::symmetricDifference(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger) {
 	ReturnCode rc = checkData(set1, set2, tolerance);
 	if (rc != ReturnCode::RC_SUCCESS) {
@@ -90,17 +397,44 @@ ISet* ISet::symmetricDifference(ISet const* set1, ISet const* set2, IVector::Nor
 		return nullptr;
 	}
 
-	ISet* u = _union(set1, set2, norm, tolerance, logger);
-	ISet* i = intersection(set1, set2, norm, tolerance, logger);
+	PointsView view1, view2;
+	view1.init(set1);
+	view2.init(set2);
+	size_t dim = view1.getDim();
 
-	ISet* result = difference(u, i, norm, tolerance, logger);
+	std::vector<bool> marked1, marked2;
+	markMutualMatches(view1, view2, norm, tolerance, marked1, marked2);
+	std::vector<double> points;
+	selectPoints(view1, marked1, false, points);
 
-	delete u;
-	delete i;
+	if (tolerance <= 0.0) {
+		selectPoints(view2, marked2, false, points);
+		return createFromPoints(dim, points, logger);
+	}
 
-	return result;
+	// kept points of set1 match nothing in set2, so only the kept points of set2 are indexed
+	points.reserve(points.size() + view2.getCount() * dim);
+	GridIndex index;
+	index.reset(dim, tolerance);
+	for (size_t j = 0; j < view2.getCount(); ++j) {
+		if (marked2[j]) {
+			continue;
+		}
+		double const* q = view2.point(j);
+		bool found = index.visit(q, [&](size_t candidate) {
+			return pointDistance(points.data() + candidate * dim, q, dim, norm) < tolerance;
+		});
+		if (!found) {
+			size_t ind = points.size() / dim;
+			points.insert(points.end(), q, q + dim);
+			index.add(points.data() + ind * dim, ind);
+		}
+	}
+
+	return createFromPoints(dim, points, logger);
 }
 
+// points of set1 having a match in set2
 ISet* ISet::intersection(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger) {
 	ReturnCode rc = checkData(set1, set2, tolerance);
 	if (rc != ReturnCode::RC_SUCCESS) {
@@ -108,21 +442,214 @@ ISet* ISet::intersection(ISet const* set1, ISet const* set2, IVector::Norm norm,
 		return nullptr;
 	}
 
-	ISet* result = set1->clone();
-	IVector* ref = nullptr;
-	rc = ReturnCode::RC_SUCCESS;
-	for (size_t i = 0; rc != ReturnCode::RC_OUT_OF_BOUNDS; ++i) {
-		rc = set1->get(ref, i);
-		if (ref != nullptr) {
-			size_t ind;
-			if (set2->find(ref, norm, tolerance, ind) != ReturnCode::RC_SUCCESS) {
-				result->erase(ref, norm, tolerance);
-			}
+	PointsView view1, view2;
+	view1.init(set1);
+	view2.init(set2);
+
+	std::vector<bool> marked;
+	markMatches(view1.point(0), view1.getCount(), view2, norm, tolerance, marked);
+	std::vector<double> points;
+	selectPoints(view1, marked, true, points);
+
+	return createFromPoints(view1.getDim(), points, logger);
+}
+
+// points of set2 matching set1 are dropped in parallel. the rest is accepted in order
+// unless an earlier accepted point of set2 matches it: points flagged as having an earlier
+// candidate are rare and are settled sequentially, later unflagged points cannot match them
+ISet* ISet::parallelUnion(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, size_t threads, ILogger* logger) {
+	ReturnCode rc = checkData(set1, set2, tolerance);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(logger, rc);
+		return nullptr;
+	}
+
+	PointsView view1, view2;
+	view1.init(set1);
+	view2.init(set2);
+	size_t dim = view1.getDim();
+	size_t count2 = view2.getCount();
 
-			delete ref;
-			ref = nullptr;
+	std::vector<char> const all;
+	std::vector<char> unmatched(count2, 1);
+	probeSlabs(view2, all, view1, all, norm, tolerance, threads, [&](size_t p, size_t) {
+		unmatched[p] = 0;
+	});
+
+	std::vector<char> accepted(unmatched);
+	std::vector<char> contested(count2, 0);
+	bool anyContested = false;
+	probeSlabs(view2, unmatched, view2, unmatched, norm, tolerance, threads, [&](size_t p, size_t r) {
+		if (r < p) {
+			contested[p] = 1;
+			accepted[p] = 0;
+		}
+	});
+	for (size_t i = 0; i < count2 && !anyContested; ++i) {
+		anyContested = contested[i] != 0;
+	}
+
+	if (anyContested) {
+		GridIndex index;
+		index.reset(dim, tolerance);
+		for (size_t i = 0; i < count2; ++i) {
+			if (accepted[i]) {
+				index.add(view2.point(i), i);
+			}
+		}
+		for (size_t i = 0; i < count2; ++i) {
+			if (!contested[i]) {
+				continue;
+			}
+			double const* q = view2.point(i);
+			bool found = index.visit(q, [&](size_t candidate) {
+				return pointDistance(view2.point(candidate), q, dim, norm) < tolerance;
+			});
+			if (!found) {
+				accepted[i] = 1;
+				index.add(q, i);
+			}
 		}
 	}
 
-	return result;
+	std::vector<double> points(view1.point(0), view1.point(0) + view1.getCount() * dim);
+	selectPoints(view2, accepted, true, points);
+
+	return createFromPoints(dim, points, logger);
+}
+
+ISet* ISet::parallelDifference(ISet const* minuend, ISet const* subtrahend, IVector::Norm norm, double tolerance, size_t threads, ILogger* logger) {
+	ReturnCode rc = checkData(minuend, subtrahend, tolerance);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(logger, rc);
+		return nullptr;
+	}
+
+	PointsView view1, view2;
+	view1.init(minuend);
+	view2.init(subtrahend);
+
+	std::vector<char> const all;
+	std::vector<char> marked(view1.getCount(), 0);
+	probeSlabs(view1, all, view2, all, norm, tolerance, threads, [&](size_t p, size_t) {
+		marked[p] = 1;
+	});
+	std::vector<double> points;
+	selectPoints(view1, marked, false, points);
+
+	return createFromPoints(view1.getDim(), points, logger);
+}
+
+ISet* ISet::parallelIntersection(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, size_t threads, ILogger* logger) {
+	ReturnCode rc = checkData(set1, set2, tolerance);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(logger, rc);
+		return nullptr;
+	}
+
+	PointsView view1, view2;
+	view1.init(set1);
+	view2.init(set2);
+
+	std::vector<char> const all;
+	std::vector<char> marked(view1.getCount(), 0);
+	probeSlabs(view1, all, view2, all, norm, tolerance, threads, [&](size_t p, size_t) {
+		marked[p] = 1;
+	});
+	std::vector<double> points;
+	selectPoints(view1, marked, true, points);
+
+	return createFromPoints(view1.getDim(), points, logger);
+}
+
+ISet::Cursor* ISet::lazyUnion(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger) {
+	ReturnCode rc = checkData(set1, set2, tolerance);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(logger, rc);
+		return nullptr;
+	}
+
+	SetCursorImpl* cursor = SetCursorImpl::create(set1->getDim(), norm, tolerance, logger);
+	if (cursor != nullptr) {
+		cursor->addStage(set1, nullptr, nullptr, false);
+		cursor->addStage(set2, nullptr, set1, false);
+	}
+	return cursor;
+}
+
+ISet::Cursor* ISet::lazyDifference(ISet const* minuend, ISet const* subtrahend, IVector::Norm norm, double tolerance, ILogger* logger) {
+	ReturnCode rc = checkData(minuend, subtrahend, tolerance);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(logger, rc);
+		return nullptr;
+	}
+
+	SetCursorImpl* cursor = SetCursorImpl::create(minuend->getDim(), norm, tolerance, logger);
+	if (cursor != nullptr) {
+		cursor->addStage(minuend, nullptr, subtrahend, false);
+	}
+	return cursor;
+}
+
+ISet::Cursor* ISet::lazySymmetricDifference(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger) {
+	ReturnCode rc = checkData(set1, set2, tolerance);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(logger, rc);
+		return nullptr;
+	}
+
+	SetCursorImpl* cursor = SetCursorImpl::create(set1->getDim(), norm, tolerance, logger);
+	if (cursor != nullptr) {
+		cursor->addStage(set1, nullptr, set2, false);
+		cursor->addStage(set2, nullptr, set1, false);
+	}
+	return cursor;
+}
+
+ISet::Cursor* ISet::lazyIntersection(ISet const* set1, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger) {
+	ReturnCode rc = checkData(set1, set2, tolerance);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(logger, rc);
+		return nullptr;
+	}
+
+	SetCursorImpl* cursor = SetCursorImpl::create(set1->getDim(), norm, tolerance, logger);
+	if (cursor != nullptr) {
+		cursor->addStage(set1, nullptr, set2, true);
+	}
+	return cursor;
+}
+
+ISet::Cursor* ISet::lazyDifference(Cursor* minuend, ISet const* subtrahend, IVector::Norm norm, double tolerance, ILogger* logger) {
+	ReturnCode rc = checkData(minuend, subtrahend, tolerance);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(logger, rc);
+		delete minuend;
+		return nullptr;
+	}
+
+	SetCursorImpl* cursor = SetCursorImpl::create(minuend->getDim(), norm, tolerance, logger);
+	if (cursor == nullptr) {
+		delete minuend;
+		return nullptr;
+	}
+	cursor->addStage(nullptr, minuend, subtrahend, false);
+	return cursor;
+}
+
+ISet::Cursor* ISet::lazyIntersection(Cursor* source, ISet const* set2, IVector::Norm norm, double tolerance, ILogger* logger) {
+	ReturnCode rc = checkData(source, set2, tolerance);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(logger, rc);
+		delete source;
+		return nullptr;
+	}
+
+	SetCursorImpl* cursor = SetCursorImpl::create(source->getDim(), norm, tolerance, logger);
+	if (cursor == nullptr) {
+		delete source;
+		return nullptr;
+	}
+	cursor->addStage(nullptr, source, set2, true);
+	return cursor;
 }
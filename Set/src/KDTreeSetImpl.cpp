@@ -0,0 +1,646 @@
+#include "../include/ISet.h"
+#include "PointDistance.h"
+#include "PointsView.h"
+#include "PointStorage.h"
+#include <stdlib.h>
+#include <cmath>	 // isnan, log2, fabs (C++11)
+#include <vector>	 // vector
+#include <utility>	 // pair
+#include <algorithm> // nth_element, sort
+#include <queue>	 // priority_queue
+#include <new>		 // nothrow
+#include <mutex>	 // mutex, lock_guard
+
+namespace {
+	/* declaration */
+	class KDTreeSetImpl : public ISet, private PointStorage {
+	private:
+		static size_t const NONE = (size_t)-1;
+
+		// a node keeps its splitting coordinate, so it goes on splitting after its point is erased
+		struct Node {
+			size_t point;
+			size_t axis;
+			size_t left;
+			size_t right;
+			double split;
+		};
+
+		ILogger* m_logger {nullptr};
+
+		// tree over point numbers, rebuilt lazily after ordered erases, once dead nodes make half of it and when it gets too deep
+		mutable std::vector<Node> m_nodes;
+		mutable size_t m_root {NONE};
+		mutable bool m_treeValid {false};
+		// node of every point, lets an unordered erase relabel the moved point in O(1)
+		mutable std::vector<size_t> m_nodeOf;
+		// nodes left by unordered erases, they split but hold no point
+		mutable size_t m_deadNodes {0};
+		// const queries may run in several threads at once, they rebuild and walk
+		// the lazy tree and the filter under this lock
+		mutable std::mutex m_lookupLock;
+
+		// tombstoned points keep their nodes, their coordinates still split the space,
+		// they are only never reported
+		void pointsRenumbered() override;
+		bool eraseMarked(std::vector<bool> const& marked);
+		ReturnCode checkQuery(IVector const* vector, std::vector<double>& query) const;
+
+		void rebuild() const;
+		size_t build(std::vector<size_t>& inds, size_t first, size_t last) const;
+		bool attach(size_t ind);
+
+		template<class Action>
+		void visitInRadius(size_t node, double const* query, IVector::Norm norm, double radius, Action& action) const;
+		void nearest(size_t node, double const* query, IVector::Norm norm, size_t k,
+					 std::priority_queue<std::pair<double, size_t>>& best) const;
+
+	public:
+		KDTreeSetImpl();
+		~KDTreeSetImpl() override;
+
+		ReturnCode insert(IVector const* vector, IVector::Norm norm, double tolerance) 	override;
+		ReturnCode erase(IVector const* vector, IVector::Norm norm, double tolerance) 	override;
+		ReturnCode erase(size_t index) 													override;
+		ReturnCode eraseAll(ISet const* other, IVector::Norm norm, double tolerance) 	override;
+		void clear() 																	override;
+		ReturnCode setEraseMode(EraseMode mode) 										override;
+		void compact() 																	override;
+		ReturnCode setFilter(bool enabled) 												override;
+		ReturnCode reserve(size_t count) 												override;
+		ReturnCode reorder(double cellSize) 											override;
+		ReturnCode setSpatialOrder(double cellSize) 									override;
+		void shrinkToFit() 																override;
+
+		ReturnCode find(IVector const* vector, IVector::Norm norm, double tolerance, size_t& ind) 	const override;
+		ReturnCode get(IVector*& dst, size_t ind) 													const override;
+		size_t getDim() 																			const override;
+		size_t getSize() 																			const override;
+		ISet* clone() 																				const override;
+		void getMemoryUsage(MemoryUsage& usage) 													const override;
+
+		ReturnCode findNearest(IVector const* vector, IVector::Norm norm, size_t k, std::vector<size_t>& inds)         const override;
+		ReturnCode findInRadius(IVector const* vector, IVector::Norm norm, double radius, std::vector<size_t>& inds) const override;
+
+		ReturnCode forEach(Visitor& visitor) 										const override;
+		ReturnCode getBlock(size_t& cursor, double const*& block, size_t& count) 	const override;
+	};
+}
+
+/* implementation */
+size_t const KDTreeSetImpl::NONE;
+
+KDTreeSetImpl::KDTreeSetImpl() {
+	m_logger = ILogger::createLogger(this);
+}
+
+KDTreeSetImpl::~KDTreeSetImpl() {
+	if (m_logger != nullptr) {
+		m_logger->releaseLogger(this);
+	}
+}
+
+void KDTreeSetImpl::pointsRenumbered() {
+	m_treeValid = false;
+}
+
+// copies coordinates of the query, they are compared with the flat storage directly
+ReturnCode KDTreeSetImpl::checkQuery(IVector const* vector, std::vector<double>& query) const {
+	if (vector == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (getCount() == 0 || m_dim == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	if (m_dim != vector->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	query.resize(m_dim);
+	return vector->getCoords(0, m_dim, query.data());
+}
+
+// median split along the axis of the widest spread
+size_t KDTreeSetImpl::build(std::vector<size_t>& inds, size_t first, size_t last) const {
+	if (first >= last) {
+		return NONE;
+	}
+
+	size_t axis = 0;
+	double widest = -1.0;
+	for (size_t d = 0; d < m_dim; ++d) {
+		double lo = point(inds[first])[d];
+		double hi = lo;
+		for (size_t i = first + 1; i < last; ++i) {
+			double x = point(inds[i])[d];
+			if (x < lo) lo = x;
+			if (x > hi) hi = x;
+		}
+		if (hi - lo > widest) {
+			widest = hi - lo;
+			axis = d;
+		}
+	}
+
+	size_t middle = first + (last - first) / 2;
+	std::nth_element(inds.begin() + first, inds.begin() + middle, inds.begin() + last,
+		[&](size_t a, size_t b) { return point(a)[axis] < point(b)[axis]; });
+
+	size_t node = m_nodes.size();
+	m_nodes.push_back(Node {inds[middle], axis, NONE, NONE, point(inds[middle])[axis]});
+	m_nodeOf[inds[middle]] = node;
+	size_t left  = build(inds, first, middle);
+	size_t right = build(inds, middle + 1, last);
+	m_nodes[node].left  = left;
+	m_nodes[node].right = right;
+	return node;
+}
+
+void KDTreeSetImpl::rebuild() const {
+	m_nodes.clear();
+	m_root = NONE;
+	size_t count = getCount();
+	std::vector<size_t> inds;
+	inds.reserve(getLiveCount());
+	for (size_t i = 0; i < count; ++i) {
+		if (isLive(i)) {
+			inds.push_back(i);
+		}
+	}
+	m_nodes.reserve(inds.size());
+	m_nodeOf.assign(count, NONE);
+	m_deadNodes = 0;
+	m_root = build(inds, 0, inds.size());
+	m_treeValid = true;
+}
+
+// appends a leaf, returns false when the path got too long and the tree needs rebalancing
+bool KDTreeSetImpl::attach(size_t ind) {
+	size_t node = m_nodes.size();
+	if (m_root == NONE) {
+		m_nodes.push_back(Node {ind, 0, NONE, NONE, point(ind)[0]});
+		m_nodeOf[ind] = node;
+		m_root = node;
+		return true;
+	}
+
+	size_t depth = 1;
+	size_t parent = m_root;
+	for (;;) {
+		Node& current = m_nodes[parent];
+		size_t& child = point(ind)[current.axis] < current.split ? current.left : current.right;
+		++depth;
+		if (child == NONE) {
+			child = node;
+			break;
+		}
+		parent = child;
+	}
+	size_t axis = (m_nodes[parent].axis + 1) % m_dim;
+	m_nodes.push_back(Node {ind, axis, NONE, NONE, point(ind)[axis]});
+	m_nodeOf[ind] = node;
+
+	return (double)depth <= 2.0 * std::log2((double)m_nodes.size() + 1.0) + 4.0;
+}
+
+// any norm of a difference is at least the difference of a single coordinate,
+// so a subtree behind the splitting plane is skipped when the plane is farther than radius
+template<class Action>
+void KDTreeSetImpl::visitInRadius(size_t node, double const* query, IVector::Norm norm, double radius, Action& action) const {
+	while (node != NONE) {
+		Node const& current = m_nodes[node];
+		if (current.point != NONE && isLive(current.point) && pointDistance(point(current.point), query, m_dim, norm) <= radius) {
+			action(current.point);
+		}
+
+		double delta = query[current.axis] - current.split;
+		size_t nearSide = delta < 0 ? current.left : current.right;
+		size_t farSide  = delta < 0 ? current.right : current.left;
+		if (std::fabs(delta) <= radius) {
+			visitInRadius(farSide, query, norm, radius, action);
+		}
+		node = nearSide;
+	}
+}
+
+void KDTreeSetImpl::nearest(size_t node, double const* query, IVector::Norm norm, size_t k,
+							std::priority_queue<std::pair<double, size_t>>& best) const {
+	if (node == NONE) {
+		return;
+	}
+
+	Node const& current = m_nodes[node];
+	if (current.point != NONE && isLive(current.point)) {
+		std::pair<double, size_t> candidate(pointDistance(point(current.point), query, m_dim, norm), current.point);
+		if (best.size() < k) {
+			best.push(candidate);
+		}
+		else if (candidate < best.top()) {
+			best.pop();
+			best.push(candidate);
+		}
+	}
+
+	double delta = query[current.axis] - current.split;
+	nearest(delta < 0 ? current.left : current.right, query, norm, k, best);
+	if (best.size() < k || std::fabs(delta) <= best.top().first) {
+		nearest(delta < 0 ? current.right : current.left, query, norm, k, best);
+	}
+}
+
+ReturnCode KDTreeSetImpl::insert(IVector const* vector, IVector::Norm norm, double tolerance) {
+	if (vector == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (m_points.empty()) {
+		startPoints(vector);
+		return ReturnCode::RC_SUCCESS;
+	}
+
+	if (m_dim != vector->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	if (compactionDue()) {
+		compact();
+	}
+
+	size_t ind;
+	if (find(vector, norm, tolerance, ind) == ReturnCode::RC_SUCCESS) {
+		return ReturnCode::RC_SUCCESS;
+	}
+
+	std::vector<double> query(m_dim);
+	vector->getCoords(0, m_dim, query.data());
+	size_t count = getCount();
+	size_t at = addPoint(query.data());
+	if (m_treeValid) {
+		// nodes keep their places, only numbers of the shifted points change
+		if (at != count) {
+			for (Node& node : m_nodes) {
+				if (node.point != NONE && node.point >= at)
+					++node.point;
+			}
+		}
+		m_nodeOf.insert(m_nodeOf.begin() + at, NONE);
+		if (!attach(at)) {
+			rebuild();
+		}
+	}
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode KDTreeSetImpl::erase(size_t index) {
+	if (index >= getCount()) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	if (!isLive(index)) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	// an unordered erase leaves the node of the erased point as a dead split and the node of the
+	// moved point takes its new number, the tree is rebuilt only once dead nodes make half of it.
+	// a tombstone keeps its node, queries skip it
+	EraseMode mode = eraseModeFor();
+	if (m_treeValid && mode == EraseMode::EM_UNORDERED) {
+		size_t last = getCount() - 1;
+		m_nodes[m_nodeOf[index]].point = NONE;
+		++m_deadNodes;
+		if (index != last) {
+			m_nodes[m_nodeOf[last]].point = index;
+			m_nodeOf[index] = m_nodeOf[last];
+		}
+		m_nodeOf.pop_back();
+		m_treeValid = 2 * m_deadNodes <= m_nodes.size();
+	}
+	erasePoint(index, mode);
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+bool KDTreeSetImpl::eraseMarked(std::vector<bool> const& marked) {
+	return eraseMarkedPoints(marked, [](size_t) {});
+}
+
+// all matches are collected by one radius search and removed in one compaction pass
+ReturnCode KDTreeSetImpl::erase(IVector const* vector, IVector::Norm norm, double tolerance) {
+	std::vector<double> query;
+	ReturnCode rc = checkQuery(vector, query);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		return rc;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	if (filterRejects(query.data(), tolerance)) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	if (!m_treeValid) {
+		rebuild();
+	}
+
+	size_t count = getCount();
+	std::vector<bool> erased(count, false);
+	bool found = false;
+	auto mark = [&](size_t ind) {
+		if (pointDistance(point(ind), query.data(), m_dim, norm) < tolerance) {
+			erased[ind] = true;
+			found = true;
+		}
+	};
+	visitInRadius(m_root, query.data(), norm, tolerance, mark);
+
+	if (!found) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	eraseMarked(erased);
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode KDTreeSetImpl::eraseAll(ISet const* other, IVector::Norm norm, double tolerance) {
+	if (other == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (getCount() == 0 || other->getSize() == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	if (m_dim != other->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	PointsView view;
+	view.init(other);
+	std::vector<bool> erased;
+	if (markMatches(m_points.data(), getCount(), view, norm, tolerance, erased) == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	return eraseMarked(erased) ? ReturnCode::RC_SUCCESS : ReturnCode::RC_ELEM_NOT_FOUND;
+}
+
+ReturnCode KDTreeSetImpl::get(IVector*& dst, size_t ind) const {
+	if (ind >= getCount()) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	if (!isLive(ind)) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	dst = IVector::createVector(m_dim, const_cast<double*>(point(ind)), m_logger);
+	return dst != nullptr ? ReturnCode::RC_SUCCESS : ReturnCode::RC_NO_MEM;
+}
+
+ReturnCode KDTreeSetImpl::find(IVector const* vector, IVector::Norm norm, double tolerance, size_t& ind) const {
+	std::vector<double> query;
+	ReturnCode rc = checkQuery(vector, query);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		return rc;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	std::lock_guard<std::mutex> lock(m_lookupLock);
+	if (filterRejects(query.data(), tolerance)) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	if (!m_treeValid) {
+		rebuild();
+	}
+
+	// the first stored match is reported, as in insertion order
+	bool found = false;
+	auto match = [&](size_t candidate) {
+		if ((!found || candidate < ind) &&
+			pointDistance(point(candidate), query.data(), m_dim, norm) < tolerance) {
+			ind = candidate;
+			found = true;
+		}
+	};
+	visitInRadius(m_root, query.data(), norm, tolerance, match);
+
+	return found ? ReturnCode::RC_SUCCESS : ReturnCode::RC_ELEM_NOT_FOUND;
+}
+
+ReturnCode KDTreeSetImpl::findNearest(IVector const* vector, IVector::Norm norm, size_t k, std::vector<size_t>& inds) const {
+	inds.clear();
+	std::vector<double> query;
+	ReturnCode rc = checkQuery(vector, query);
+	if (rc != ReturnCode::RC_SUCCESS || k == 0) {
+		return rc;
+	}
+
+	std::lock_guard<std::mutex> lock(m_lookupLock);
+	if (!m_treeValid) {
+		rebuild();
+	}
+
+	std::priority_queue<std::pair<double, size_t>> best;
+	nearest(m_root, query.data(), norm, k, best);
+
+	inds.resize(best.size());
+	for (size_t i = inds.size(); i > 0; --i) {
+		inds[i - 1] = best.top().second;
+		best.pop();
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode KDTreeSetImpl::findInRadius(IVector const* vector, IVector::Norm norm, double radius, std::vector<size_t>& inds) const {
+	inds.clear();
+	std::vector<double> query;
+	ReturnCode rc = checkQuery(vector, query);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		return rc;
+	}
+
+	if (std::isnan(radius)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (radius < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	std::lock_guard<std::mutex> lock(m_lookupLock);
+	if (!m_treeValid) {
+		rebuild();
+	}
+
+	auto collect = [&](size_t ind) { inds.push_back(ind); };
+	visitInRadius(m_root, query.data(), norm, radius, collect);
+	std::sort(inds.begin(), inds.end());
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode KDTreeSetImpl::forEach(Visitor& visitor) const {
+	return visitPoints(visitor);
+}
+
+ReturnCode KDTreeSetImpl::getBlock(size_t& cursor, double const*& block, size_t& count) const {
+	return nextBlock(cursor, block, count);
+}
+
+size_t KDTreeSetImpl::getDim() const {
+	return m_dim;
+}
+
+size_t KDTreeSetImpl::getSize() const {
+	return getLiveCount();
+}
+
+ISet* KDTreeSetImpl::clone() const {
+	KDTreeSetImpl* set = new(std::nothrow) KDTreeSetImpl();
+	if (set == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NO_MEM);
+		return nullptr;
+	}
+
+	set->copyPoints(*this);
+	std::lock_guard<std::mutex> lock(m_lookupLock);
+	set->m_nodes = m_nodes;
+	set->m_root = m_root;
+	set->m_treeValid = m_treeValid;
+	set->m_nodeOf = m_nodeOf;
+	set->m_deadNodes = m_deadNodes;
+
+	return set;
+}
+
+void KDTreeSetImpl::clear() {
+	m_nodes.clear();
+	m_root = NONE;
+	m_nodeOf.clear();
+	m_deadNodes = 0;
+	clearPoints();
+}
+
+ReturnCode KDTreeSetImpl::setEraseMode(EraseMode mode) {
+	if (!knownEraseMode(mode)) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	switchEraseMode(mode);
+	return ReturnCode::RC_SUCCESS;
+}
+
+void KDTreeSetImpl::compact() {
+	dropTombstones();
+}
+
+ReturnCode KDTreeSetImpl::setFilter(bool enabled) {
+	setFilterEnabled(enabled);
+	return ReturnCode::RC_SUCCESS;
+}
+
+// nodes are reserved as well, every point gets one
+ReturnCode KDTreeSetImpl::reserve(size_t count) {
+	ReturnCode rc = reservePoints(count);
+	if (rc == ReturnCode::RC_SUCCESS && m_dim != 0) {
+		if (count > m_nodes.max_size()) {
+			rc = ReturnCode::RC_NO_MEM;
+		}
+		else {
+			try {
+				m_nodes.reserve(count);
+				m_nodeOf.reserve(count);
+			}
+			catch (std::bad_alloc const&) {
+				rc = ReturnCode::RC_NO_MEM;
+			}
+		}
+	}
+
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(m_logger, rc);
+	}
+	return rc;
+}
+
+// the tree stays, it is as compact as the points
+void KDTreeSetImpl::shrinkToFit() {
+	shrinkPoints();
+	m_nodes.shrink_to_fit();
+	m_nodeOf.shrink_to_fit();
+}
+
+void KDTreeSetImpl::getMemoryUsage(MemoryUsage& usage) const {
+	std::lock_guard<std::mutex> lock(m_lookupLock);
+	usage.points = m_points.capacity() * sizeof(double);
+	usage.index = m_nodes.capacity() * sizeof(Node) + m_nodeOf.capacity() * sizeof(size_t) + m_filter.memoryUsage();
+	usage.overhead = sizeof(*this) + m_erased.capacity() / 8;
+}
+
+ReturnCode KDTreeSetImpl::reorder(double cellSize) {
+	ReturnCode rc = reorderPoints(cellSize);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(m_logger, rc);
+	}
+	return rc;
+}
+
+ReturnCode KDTreeSetImpl::setSpatialOrder(double cellSize) {
+	ReturnCode rc = setPointOrder(cellSize);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(m_logger, rc);
+	}
+	return rc;
+}
@@ -0,0 +1,219 @@
+#ifndef LSH_INDEX_H
+#define LSH_INDEX_H
+
+#include "../../Vector/include/IVector.h"
+#include "GridIndex.h"
+#include <cstddef>		 // size_t
+#include <cmath>		 // floor, sqrt, isnan
+#include <vector>		 // vector
+#include <unordered_map> // unordered_map
+#include <random>		 // mt19937_64, normal_distribution, uniform_real_distribution
+
+namespace {
+	/* declaration */
+	// random projection hashing for high-dimensional points. every table hashes a point
+	// by several projections onto random gaussian directions, each quantized to buckets
+	// a few tolerances wide, so close points share a bucket with high probability.
+	// lookups are approximate, a point may be reported once per table it shares with the query.
+	// the index stores point numbers only, callers verify candidates against their own storage.
+	class LSHIndex {
+	public:
+		LSHIndex() = default;
+
+		void configure(size_t tables, size_t projections, double width, unsigned long long seed);
+		bool configured() const;
+
+		void reset(size_t dim, double tolerance, IVector::Norm norm);
+		void clear();
+		bool suits(double tolerance, IVector::Norm norm) const;
+
+		void add(double const* point, size_t ind);
+		void remove(double const* point, size_t ind);
+		void relabel(double const* point, size_t from, size_t to);
+		// numbers from first on grow by one, making room for a point inserted at first
+		void shift(size_t first);
+
+		// calls action(ind) for every point sharing a bucket with the point until it returns true
+		template<class Action>
+		bool visit(double const* point, Action action) const;
+
+		// heap bytes held by the directions and the tables
+		size_t memoryUsage() const;
+
+	private:
+		double reach(double tolerance, IVector::Norm norm) const;
+		unsigned long long bucket(size_t table, double const* point) const;
+
+		size_t m_tables {0};
+		size_t m_projections {0};
+		double m_widthFactor {0.0};
+		unsigned long long m_seed {0};
+
+		size_t m_dim {0};
+		double m_reach {0.0};
+		double m_width {0.0};
+		// tables * projections directions of m_dim coordinates and as many offsets in [0, m_width)
+		std::vector<double> m_directions;
+		std::vector<double> m_offsets;
+		std::vector<std::unordered_map<unsigned long long, std::vector<size_t>>> m_buckets;
+	};
+}
+
+/* implementation */
+// keeps quantized projections away from long long overflow
+static double const LSH_KEY_LIMIT = 4.0e18;
+
+void LSHIndex::configure(size_t tables, size_t projections, double width, unsigned long long seed) {
+	m_tables = tables;
+	m_projections = projections;
+	m_widthFactor = width;
+	m_seed = seed;
+	clear();
+}
+
+bool LSHIndex::configured() const {
+	return m_tables != 0;
+}
+
+// euclidean distance bound of points closer than the tolerance in the norm,
+// projections onto unit gaussian directions follow the euclidean distance
+double LSHIndex::reach(double tolerance, IVector::Norm norm) const {
+	return norm == IVector::Norm::NORM_INF ? tolerance * std::sqrt((double)m_dim) : tolerance;
+}
+
+void LSHIndex::reset(size_t dim, double tolerance, IVector::Norm norm) {
+	clear();
+	m_dim = dim;
+	m_reach = reach(tolerance, norm);
+	m_width = m_reach * m_widthFactor;
+
+	std::mt19937_64 random(m_seed);
+	std::normal_distribution<double> direction(0.0, 1.0);
+	std::uniform_real_distribution<double> offset(0.0, m_width);
+	m_directions.resize(m_tables * m_projections * m_dim);
+	for (double& x : m_directions) {
+		x = direction(random);
+	}
+	m_offsets.resize(m_tables * m_projections);
+	for (double& x : m_offsets) {
+		x = offset(random);
+	}
+	m_buckets.resize(m_tables);
+}
+
+// the configuration survives clear
+void LSHIndex::clear() {
+	m_buckets.clear();
+	m_directions.clear();
+	m_offsets.clear();
+	m_dim = 0;
+	m_reach = 0.0;
+	m_width = 0.0;
+}
+
+// narrower buckets lose recall and wider ones bring more candidates,
+// so the index is rebuilt once the euclidean reach of the query changes much
+bool LSHIndex::suits(double tolerance, IVector::Norm norm) const {
+	double r = reach(tolerance, norm);
+	return m_dim != 0 && r > 0.0 && r <= m_reach && r * 2.0 >= m_reach;
+}
+
+unsigned long long LSHIndex::bucket(size_t table, double const* point) const {
+	unsigned long long hash = 1469598103934665603ULL;
+	for (size_t j = 0; j < m_projections; ++j) {
+		size_t row = table * m_projections + j;
+		double const* direction = m_directions.data() + row * m_dim;
+		double projection = 0.0;
+		for (size_t i = 0; i < m_dim; ++i) {
+			projection += direction[i] * point[i];
+		}
+		double q = std::floor((projection + m_offsets[row]) / m_width);
+		if (std::isnan(q))
+			q = 0.0;
+		if (q > LSH_KEY_LIMIT)
+			q = LSH_KEY_LIMIT;
+		if (q < -LSH_KEY_LIMIT)
+			q = -LSH_KEY_LIMIT;
+		hash ^= (unsigned long long)(long long)q;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+void LSHIndex::add(double const* point, size_t ind) {
+	for (size_t t = 0; t < m_tables; ++t) {
+		m_buckets[t][bucket(t, point)].push_back(ind);
+	}
+}
+
+void LSHIndex::remove(double const* point, size_t ind) {
+	for (size_t t = 0; t < m_tables; ++t) {
+		auto cell = m_buckets[t].find(bucket(t, point));
+		if (cell == m_buckets[t].end()) {
+			continue;
+		}
+		std::vector<size_t>& inds = cell->second;
+		for (size_t i = 0; i < inds.size(); ++i) {
+			if (inds[i] == ind) {
+				inds[i] = inds.back();
+				inds.pop_back();
+				break;
+			}
+		}
+		if (inds.empty()) {
+			m_buckets[t].erase(cell);
+		}
+	}
+}
+
+void LSHIndex::relabel(double const* point, size_t from, size_t to) {
+	for (size_t t = 0; t < m_tables; ++t) {
+		auto cell = m_buckets[t].find(bucket(t, point));
+		if (cell == m_buckets[t].end()) {
+			continue;
+		}
+		for (size_t& ind : cell->second) {
+			if (ind == from) {
+				ind = to;
+				break;
+			}
+		}
+	}
+}
+
+void LSHIndex::shift(size_t first) {
+	for (auto& table : m_buckets) {
+		for (auto& cell : table) {
+			for (size_t& ind : cell.second) {
+				if (ind >= first)
+					++ind;
+			}
+		}
+	}
+}
+
+size_t LSHIndex::memoryUsage() const {
+	size_t bytes = (m_directions.capacity() + m_offsets.capacity()) * sizeof(double) +
+				   m_buckets.capacity() * sizeof(m_buckets[0]);
+	for (auto const& table : m_buckets) {
+		bytes += hashMapMemory(table);
+	}
+	return bytes;
+}
+
+template<class Action>
+bool LSHIndex::visit(double const* point, Action action) const {
+	for (size_t t = 0; t < m_buckets.size(); ++t) {
+		auto cell = m_buckets[t].find(bucket(t, point));
+		if (cell == m_buckets[t].end()) {
+			continue;
+		}
+		for (size_t ind : cell->second) {
+			if (action(ind))
+				return true;
+		}
+	}
+	return false;
+}
+
+#endif /* LSH_INDEX_H */
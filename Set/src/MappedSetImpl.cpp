@@ -0,0 +1,591 @@
+#include "../include/ISet.h"
+#include "../../Util/FileMapping.h"
+#include "CellFilter.h"
+#include "GridIndex.h"
+#include "PointDistance.h"
+#include <stdint.h>	 // uint32_t, uint64_t
+#include <cstring>	 // memcmp
+#include <cmath>	 // isnan
+#include <vector>	 // vector
+#include <utility>	 // pair
+#include <algorithm> // lower_bound, partial_sort
+#include <new>		 // nothrow
+#include <mutex>	 // mutex, lock_guard
+
+// not a unit of its own: ISet.cpp includes it after SetImpl.cpp, whose class it detaches into
+namespace {
+	/* on-disk layout: the header, count row-major points, the cell table sorted by GridIndex::mortonLess
+	   and the numbers of the points grouped by cell. every part stays 8 byte aligned */
+	struct SetFileHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t dim;
+		uint64_t count;
+		// cell size of the stored grid, zero when the file holds no index
+		double tolerance;
+		uint64_t cellCount;
+	};
+
+	// points of the cell are order[first], ..., order[first + count - 1]
+	struct SetFileCell {
+		int64_t coord[GridIndex::MAX_KEY_DIM];
+		uint64_t first;
+		uint64_t count;
+	};
+
+	static char const SET_FILE_MAGIC[4] = {'I', 'S', 'E', 'T'};
+	static uint32_t const SET_FILE_VERSION = 1;
+
+	/* declaration */
+	// set served straight from a mapped file, queries read the stored grid without building anything.
+	// the first change copies the points into an ordinary set and every call is forwarded to it afterwards
+	class MappedSetImpl : public ISet {
+	private:
+		size_t m_dim {0};
+		size_t m_count {0};
+		double const* m_points {nullptr};
+		double m_tolerance {0.0};
+		SetFileCell const* m_cells {nullptr};
+		size_t m_cellCount {0};
+		uint64_t const* m_order {nullptr};
+		void* m_view {nullptr};
+		size_t m_viewSize {0};
+		// quantizes queries the way the stored grid was built, holds no points
+		GridIndex m_grid;
+		// built from the mapped points by the first query that needs it,
+		// concurrent const queries build and read it under the lock
+		bool m_filterEnabled {false};
+		mutable CellFilter m_filter;
+		mutable std::mutex m_filterLock;
+
+		SetImpl* m_owned {nullptr};
+		EraseMode m_eraseMode {EraseMode::EM_ORDERED};
+		ILogger* m_logger {nullptr};
+
+		MappedSetImpl(void* view, size_t viewSize);
+
+		double const* point(size_t ind) const;
+		SetImpl* copyToSet(bool keepPoints) const;
+		SetImpl* detach(bool keepPoints = true);
+		template<class Action>
+		void visitCandidates(double const* query, Action action) const;
+
+	public:
+		static ISet* createFromFile(char const* fileName, ILogger* logger);
+
+		~MappedSetImpl() override;
+
+		ReturnCode insert(IVector const* vector, IVector::Norm norm, double tolerance) 	override;
+		ReturnCode erase(IVector const* vector, IVector::Norm norm, double tolerance) 	override;
+		ReturnCode erase(size_t index) 													override;
+		ReturnCode eraseAll(ISet const* other, IVector::Norm norm, double tolerance) 	override;
+		void clear() 																	override;
+		ReturnCode setEraseMode(EraseMode mode) 										override;
+		void compact() 																	override;
+		ReturnCode setFilter(bool enabled) 												override;
+		ReturnCode reserve(size_t count) 												override;
+		ReturnCode reorder(double cellSize) 											override;
+		ReturnCode setSpatialOrder(double cellSize) 									override;
+		void shrinkToFit() 																override;
+
+		ReturnCode find(IVector const* vector, IVector::Norm norm, double tolerance, size_t& ind) 	const override;
+		ReturnCode get(IVector*& dst, size_t ind) 													const override;
+		size_t getDim() 																			const override;
+		size_t getSize() 																			const override;
+		ISet* clone() 																				const override;
+		void getMemoryUsage(MemoryUsage& usage) 													const override;
+
+		ReturnCode findNearest(IVector const* vector, IVector::Norm norm, size_t k, std::vector<size_t>& inds)         const override;
+		ReturnCode findInRadius(IVector const* vector, IVector::Norm norm, double radius, std::vector<size_t>& inds) const override;
+
+		ReturnCode forEach(Visitor& visitor) 										const override;
+		ReturnCode getBlock(size_t& cursor, double const*& block, size_t& count) 	const override;
+	};
+}
+
+/* implementation */
+static bool mortonLessCell(SetFileCell const& cell, GridIndex::CellKey const& key) {
+	GridIndex::CellKey cellKey;
+	for (size_t i = 0; i < GridIndex::MAX_KEY_DIM; ++i) {
+		cellKey.coord[i] = (long long)cell.coord[i];
+	}
+	return GridIndex::mortonLess(cellKey, key);
+}
+
+ISet* MappedSetImpl::createFromFile(char const* fileName, ILogger* logger) {
+	size_t viewSize = 0;
+	void* view = mapFile(fileName, false, viewSize);
+	if (view == nullptr) {
+		LOG(logger, ReturnCode::RC_OPEN_FILE);
+		return nullptr;
+	}
+
+	// only the layout is validated, points and cells are paged in on first access
+	SetFileHeader const* header = static_cast<SetFileHeader const*>(view);
+	if (viewSize < sizeof(SetFileHeader) ||
+		std::memcmp(header->magic, SET_FILE_MAGIC, sizeof(SET_FILE_MAGIC)) != 0 ||
+		header->version != SET_FILE_VERSION ||
+		std::isnan(header->tolerance) || header->tolerance < 0.0 ||
+		(header->cellCount != 0 && header->tolerance == 0.0)) {
+		LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+		unmapFile(view, viewSize);
+		return nullptr;
+	}
+
+	if (header->dim == 0) {
+		LOG(logger, ReturnCode::RC_ZERO_DIM);
+		unmapFile(view, viewSize);
+		return nullptr;
+	}
+
+	// sizes are compared part by part so that no product overflows
+	uint64_t rest = (viewSize - sizeof(SetFileHeader)) / sizeof(double);
+	if (header->dim > rest || header->count > rest / header->dim) {
+		LOG(logger, ReturnCode::RC_WRONG_DIM);
+		unmapFile(view, viewSize);
+		return nullptr;
+	}
+	rest = (rest - header->count * header->dim) * sizeof(double);
+	if (header->cellCount > rest / sizeof(SetFileCell) ||
+		(header->cellCount != 0 && header->count > (rest - header->cellCount * sizeof(SetFileCell)) / sizeof(uint64_t))) {
+		LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+		unmapFile(view, viewSize);
+		return nullptr;
+	}
+
+	MappedSetImpl* set = new(std::nothrow) MappedSetImpl(view, viewSize);
+	if (set == nullptr) {
+		LOG(logger, ReturnCode::RC_NO_MEM);
+		unmapFile(view, viewSize);
+		return nullptr;
+	}
+
+	return set;
+}
+
+MappedSetImpl::MappedSetImpl(void* view, size_t viewSize) :
+	m_view(view),
+	m_viewSize(viewSize) {
+	SetFileHeader const* header = static_cast<SetFileHeader const*>(view);
+	char const* data = static_cast<char const*>(view) + sizeof(SetFileHeader);
+	m_dim = (size_t)header->dim;
+	m_count = (size_t)header->count;
+	m_points = reinterpret_cast<double const*>(data);
+	data += m_count * m_dim * sizeof(double);
+	m_tolerance = header->tolerance;
+	m_cellCount = (size_t)header->cellCount;
+	m_cells = reinterpret_cast<SetFileCell const*>(data);
+	data += m_cellCount * sizeof(SetFileCell);
+	m_order = reinterpret_cast<uint64_t const*>(data);
+	if (m_cellCount != 0) {
+		m_grid.reset(m_dim, m_tolerance);
+	}
+
+	m_logger = ILogger::createLogger(this);
+}
+
+MappedSetImpl::~MappedSetImpl() {
+	delete m_owned;
+	unmapFile(m_view, m_viewSize);
+	m_view = nullptr;
+	m_points = nullptr;
+
+	if (m_logger != nullptr) {
+		m_logger->releaseLogger(this);
+	}
+}
+
+double const* MappedSetImpl::point(size_t ind) const {
+	return m_points + ind * m_dim;
+}
+
+// an ordinary set with the mapped points, the tolerance of their grid and the settings of this set,
+// nullptr when there is no memory for the copy
+SetImpl* MappedSetImpl::copyToSet(bool keepPoints) const {
+	SetImpl* set = new(std::nothrow) SetImpl();
+	if (set != nullptr) {
+		// the grid of the copy is built at once, it needs memory as well
+		try {
+			std::vector<double> points;
+			if (keepPoints) {
+				points.assign(m_points, m_points + m_count * m_dim);
+			}
+			set->assign(m_dim, points, m_tolerance);
+		}
+		catch (std::bad_alloc const&) {
+			delete set;
+			set = nullptr;
+		}
+	}
+	if (set == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NO_MEM);
+		return nullptr;
+	}
+
+	set->setEraseMode(m_eraseMode);
+	set->setFilter(m_filterEnabled);
+	return set;
+}
+
+// moves the mapped points into an ordinary set and releases the mapping
+SetImpl* MappedSetImpl::detach(bool keepPoints) {
+	if (m_owned != nullptr) {
+		return m_owned;
+	}
+
+	SetImpl* set = copyToSet(keepPoints);
+	if (set == nullptr) {
+		return nullptr;
+	}
+
+	m_filter.clear();
+	unmapFile(m_view, m_viewSize);
+	m_view = nullptr;
+	m_points = nullptr;
+	m_count = 0;
+	m_cellCount = 0;
+	m_owned = set;
+	return set;
+}
+
+ReturnCode MappedSetImpl::insert(IVector const* vector, IVector::Norm norm, double tolerance) {
+	SetImpl* set = detach();
+	return set != nullptr ? set->insert(vector, norm, tolerance) : ReturnCode::RC_NO_MEM;
+}
+
+ReturnCode MappedSetImpl::erase(IVector const* vector, IVector::Norm norm, double tolerance) {
+	SetImpl* set = detach();
+	return set != nullptr ? set->erase(vector, norm, tolerance) : ReturnCode::RC_NO_MEM;
+}
+
+ReturnCode MappedSetImpl::erase(size_t index) {
+	SetImpl* set = detach();
+	return set != nullptr ? set->erase(index) : ReturnCode::RC_NO_MEM;
+}
+
+ReturnCode MappedSetImpl::eraseAll(ISet const* other, IVector::Norm norm, double tolerance) {
+	SetImpl* set = detach();
+	return set != nullptr ? set->eraseAll(other, norm, tolerance) : ReturnCode::RC_NO_MEM;
+}
+
+void MappedSetImpl::clear() {
+	SetImpl* set = detach(false);
+	if (set != nullptr) {
+		set->clear();
+	}
+}
+
+// the mode is kept until the set detaches, mapped points are never erased
+ReturnCode MappedSetImpl::setEraseMode(EraseMode mode) {
+	if (m_owned != nullptr) {
+		return m_owned->setEraseMode(mode);
+	}
+
+	if (mode != EraseMode::EM_ORDERED && mode != EraseMode::EM_UNORDERED && mode != EraseMode::EM_TOMBSTONE) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	m_eraseMode = mode;
+	return ReturnCode::RC_SUCCESS;
+}
+
+void MappedSetImpl::compact() {
+	if (m_owned != nullptr) {
+		m_owned->compact();
+	}
+}
+
+ReturnCode MappedSetImpl::setFilter(bool enabled) {
+	if (m_owned != nullptr) {
+		return m_owned->setFilter(enabled);
+	}
+
+	m_filterEnabled = enabled;
+	m_filter.clear();
+	return ReturnCode::RC_SUCCESS;
+}
+
+// reserving room means points are about to be inserted, so the set detaches at once
+ReturnCode MappedSetImpl::reserve(size_t count) {
+	SetImpl* set = detach();
+	return set != nullptr ? set->reserve(count) : ReturnCode::RC_NO_MEM;
+}
+
+// the mapped points are read-only, reordering works on the detached copy
+ReturnCode MappedSetImpl::reorder(double cellSize) {
+	SetImpl* set = detach();
+	return set != nullptr ? set->reorder(cellSize) : ReturnCode::RC_NO_MEM;
+}
+
+ReturnCode MappedSetImpl::setSpatialOrder(double cellSize) {
+	if (m_owned == nullptr && cellSize == 0.0) {
+		return ReturnCode::RC_SUCCESS;
+	}
+
+	SetImpl* set = detach();
+	return set != nullptr ? set->setSpatialOrder(cellSize) : ReturnCode::RC_NO_MEM;
+}
+
+void MappedSetImpl::shrinkToFit() {
+	if (m_owned != nullptr) {
+		m_owned->shrinkToFit();
+		return;
+	}
+
+	m_filter.clear();
+}
+
+// mapped pages are counted as well, they are loaded on first access
+void MappedSetImpl::getMemoryUsage(MemoryUsage& usage) const {
+	if (m_owned != nullptr) {
+		m_owned->getMemoryUsage(usage);
+		usage.overhead += sizeof(*this);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_filterLock);
+	usage.points = m_count * m_dim * sizeof(double);
+	usage.index = m_cellCount * sizeof(SetFileCell) + (m_cellCount != 0 ? m_count * sizeof(uint64_t) : 0) +
+				  m_filter.memoryUsage();
+	usage.overhead = sizeof(*this) + sizeof(SetFileHeader);
+}
+
+// calls action(ind) for every point of the stored cells neighbouring the query,
+// cells are found by binary search in the Z-ordered table
+template<class Action>
+void MappedSetImpl::visitCandidates(double const* query, Action action) const {
+	m_grid.visitCells(query, [&](GridIndex::CellKey const& key) {
+		SetFileCell const* end = m_cells + m_cellCount;
+		SetFileCell const* cell = std::lower_bound(m_cells, end, key, mortonLessCell);
+		if (cell == end) {
+			return false;
+		}
+		for (size_t i = 0; i < GridIndex::MAX_KEY_DIM; ++i) {
+			if (cell->coord[i] != key.coord[i])
+				return false;
+		}
+		// damaged files cannot point outside the mapping
+		if (cell->first > m_count || cell->count > m_count - cell->first) {
+			return false;
+		}
+		for (uint64_t j = cell->first; j < cell->first + cell->count; ++j) {
+			if (m_order[j] < m_count) {
+				action((size_t)m_order[j]);
+			}
+		}
+		return false;
+	});
+}
+
+ReturnCode MappedSetImpl::find(IVector const* vector, IVector::Norm norm, double tolerance, size_t& ind) const {
+	if (m_owned != nullptr) {
+		return m_owned->find(vector, norm, tolerance, ind);
+	}
+
+	if (vector == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (m_dim != vector->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	if (tolerance == 0.0 || m_count == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	std::vector<double> query(m_dim);
+	vector->getCoords(0, m_dim, query.data());
+
+	// the mapped points never change, so the filter is rebuilt only for another tolerance
+	if (m_filterEnabled) {
+		std::lock_guard<std::mutex> lock(m_filterLock);
+		if (!m_filter.suits(tolerance) && m_filter.reset(m_dim, tolerance, m_count)) {
+			for (size_t i = 0; i < m_count; ++i) {
+				m_filter.add(point(i));
+			}
+		}
+		if (!m_filter.mayContain(query.data())) {
+			return ReturnCode::RC_ELEM_NOT_FOUND;
+		}
+	}
+
+	// the first stored match is reported, as in insertion order
+	bool found = false;
+	if (m_cellCount != 0 && tolerance <= m_tolerance) {
+		visitCandidates(query.data(), [&](size_t candidate) {
+			if ((!found || candidate < ind) &&
+				pointDistance(point(candidate), query.data(), m_dim, norm) < tolerance) {
+				ind = candidate;
+				found = true;
+			}
+		});
+	}
+	else {
+		// cells narrower than the tolerance could miss matches
+		for (size_t i = 0; i < m_count && !found; ++i) {
+			if (pointDistance(point(i), query.data(), m_dim, norm) < tolerance) {
+				ind = i;
+				found = true;
+			}
+		}
+	}
+
+	return found ? ReturnCode::RC_SUCCESS : ReturnCode::RC_ELEM_NOT_FOUND;
+}
+
+ReturnCode MappedSetImpl::get(IVector*& dst, size_t ind) const {
+	if (m_owned != nullptr) {
+		return m_owned->get(dst, ind);
+	}
+
+	if (ind >= m_count) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	dst = IVector::createVector(m_dim, const_cast<double*>(point(ind)), m_logger);
+	return dst != nullptr ? ReturnCode::RC_SUCCESS : ReturnCode::RC_NO_MEM;
+}
+
+size_t MappedSetImpl::getDim() const {
+	return m_owned != nullptr ? m_owned->getDim() : m_dim;
+}
+
+size_t MappedSetImpl::getSize() const {
+	return m_owned != nullptr ? m_owned->getSize() : m_count;
+}
+
+// clone is an ordinary set, the mapping is not shared
+ISet* MappedSetImpl::clone() const {
+	if (m_owned != nullptr) {
+		return m_owned->clone();
+	}
+
+	return copyToSet(true);
+}
+
+ReturnCode MappedSetImpl::findNearest(IVector const* vector, IVector::Norm norm, size_t k, std::vector<size_t>& inds) const {
+	if (m_owned != nullptr) {
+		return m_owned->findNearest(vector, norm, k, inds);
+	}
+
+	inds.clear();
+	if (vector == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (m_dim != vector->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	if (m_count == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	std::vector<double> query(m_dim);
+	vector->getCoords(0, m_dim, query.data());
+	std::vector<std::pair<double, size_t>> distances(m_count);
+	for (size_t i = 0; i < m_count; ++i) {
+		distances[i] = std::make_pair(pointDistance(point(i), query.data(), m_dim, norm), i);
+	}
+
+	if (k > m_count) {
+		k = m_count;
+	}
+	std::partial_sort(distances.begin(), distances.begin() + k, distances.end());
+	inds.resize(k);
+	for (size_t i = 0; i < k; ++i) {
+		inds[i] = distances[i].second;
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode MappedSetImpl::findInRadius(IVector const* vector, IVector::Norm norm, double radius, std::vector<size_t>& inds) const {
+	if (m_owned != nullptr) {
+		return m_owned->findInRadius(vector, norm, radius, inds);
+	}
+
+	inds.clear();
+	if (vector == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (m_dim != vector->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	if (std::isnan(radius)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (radius < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	if (m_count == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	std::vector<double> query(m_dim);
+	vector->getCoords(0, m_dim, query.data());
+	for (size_t i = 0; i < m_count; ++i) {
+		if (pointDistance(point(i), query.data(), m_dim, norm) <= radius) {
+			inds.push_back(i);
+		}
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode MappedSetImpl::forEach(Visitor& visitor) const {
+	if (m_owned != nullptr) {
+		return m_owned->forEach(visitor);
+	}
+
+	for (size_t i = 0; i < m_count; ++i) {
+		if (!visitor.visit(i, point(i))) {
+			break;
+		}
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+// the mapped points are one contiguous block
+ReturnCode MappedSetImpl::getBlock(size_t& cursor, double const*& block, size_t& count) const {
+	if (m_owned != nullptr) {
+		return m_owned->getBlock(cursor, block, count);
+	}
+
+	block = nullptr;
+	count = 0;
+	if (cursor >= m_count) {
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	block = point(cursor);
+	count = m_count - cursor;
+	cursor = m_count;
+	return ReturnCode::RC_SUCCESS;
+}
@@ -0,0 +1,39 @@
+#ifndef POINT_DISTANCE_H
+#define POINT_DISTANCE_H
+
+#include "../../Vector/include/IVector.h"
+#include <cstddef> // size_t
+#include <cmath>   // sqrt, fabs (C++11)
+
+// norm of (a - b), computed in the same order as IVector::sub followed by IVector::norm,
+// so comparing it with a tolerance gives exactly the IVector::equals verdict
+static inline double pointDistance(double const* a, double const* b, size_t dim, IVector::Norm norm) {
+	double result = 0;
+	switch (norm) {
+	case IVector::Norm::NORM_1:
+		for (size_t i = 0; i < dim; ++i) {
+			result += std::fabs(a[i] - b[i]);
+		}
+		break;
+	case IVector::Norm::NORM_2:
+		for (size_t i = 0; i < dim; ++i) {
+			double diff = a[i] - b[i];
+			result += diff * diff;
+		}
+		result = std::sqrt(result);
+		break;
+	case IVector::Norm::NORM_INF:
+		result = std::fabs(a[0] - b[0]);
+		for (size_t i = 1; i < dim; ++i) {
+			if (result < std::fabs(a[i] - b[i]))
+				result = std::fabs(a[i] - b[i]);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return result;
+}
+
+#endif /* POINT_DISTANCE_H */
@@ -0,0 +1,417 @@
+#ifndef POINT_STORAGE_H
+#define POINT_STORAGE_H
+
+#include "../include/ISet.h"
+#include "CellFilter.h"
+#include "GridIndex.h"
+#include "PointsView.h"
+#include <cstddef>	 // size_t
+#include <cmath>	 // isnan, isinf
+#include <vector>	 // vector
+#include <new>		 // bad_alloc
+
+namespace {
+	/* declaration */
+	// flat row-major storage of the sets that keep their points in one buffer: tombstones,
+	// the maintained Z-order and the membership filter. a set derives from it, keeps its lookup
+	// structure on top and is told by pointsRenumbered() when the numbers it holds went stale
+	class PointStorage {
+	protected:
+		size_t m_dim {0};
+		// row-major coordinates, point i occupies [i * m_dim, (i + 1) * m_dim)
+		std::vector<double> m_points;
+
+		// points reserved by reserve() on an empty set, applied by the first insert
+		size_t m_reservedCount {0};
+		// cell size of the maintained Z-order, zero keeps insertion order
+		double m_orderCell {0.0};
+
+		ISet::EraseMode m_eraseMode {ISet::EraseMode::EM_ORDERED};
+		// tombstones, empty while no slot is erased
+		std::vector<bool> m_erased;
+		size_t m_erasedCount {0};
+
+		// definite misses are answered without the points, built lazily for the tolerance of the query
+		bool m_filterEnabled {false};
+		mutable CellFilter m_filter;
+		mutable bool m_filterValid {false};
+
+		PointStorage() = default;
+		virtual ~PointStorage() = default;
+
+		// called once points got new numbers, the lookup structure built over the old ones is dropped
+		virtual void pointsRenumbered() = 0;
+
+		double const* point(size_t ind) const;
+		size_t getCount() const;
+		size_t getLiveCount() const;
+		bool isLive(size_t ind) const;
+
+		// everything but the filter bits, which the next query rebuilds
+		void copyPoints(PointStorage const& other);
+		// takes over a row-major buffer of distinct points, the buffer is left empty
+		void assignPoints(size_t dim, std::vector<double>& points);
+		// the erase mode, the filter switch and the spatial order survive, they are properties of the set
+		void clearPoints();
+		// stores the first point, the dimension is known from now on
+		void startPoints(IVector const* vector);
+		bool compactionDue() const;
+		// puts the point to its place in the maintained order or last, returns its number
+		size_t addPoint(double const* p);
+
+		// the mode erase(size_t) applies to a live point
+		ISet::EraseMode eraseModeFor() const;
+		void erasePoint(size_t index, ISet::EraseMode mode);
+		// removes flagged live points, returns false when there is none. tombstone mode calls
+		// onTombstone(i) for every point it marks and keeps numbers of the rest
+		template<class Action>
+		bool eraseMarkedPoints(std::vector<bool> const& marked, Action onTombstone);
+		void dropTombstones();
+		bool knownEraseMode(ISet::EraseMode mode) const;
+		void switchEraseMode(ISet::EraseMode mode);
+
+		ReturnCode reservePoints(size_t count);
+		void shrinkPoints();
+		ReturnCode reorderPoints(double cellSize);
+		ReturnCode setPointOrder(double cellSize);
+
+		// true when the filter proves that no live point lies closer than the tolerance
+		bool filterRejects(double const* query, double tolerance) const;
+		void setFilterEnabled(bool enabled);
+
+		ReturnCode visitPoints(ISet::Visitor& visitor) const;
+		ReturnCode nextBlock(size_t& cursor, double const*& block, size_t& count) const;
+
+	private:
+		PointStorage(PointStorage const&)			 = delete;
+		PointStorage& operator=(PointStorage const&) = delete;
+	};
+}
+
+/* implementation */
+double const* PointStorage::point(size_t ind) const {
+	return m_points.data() + ind * m_dim;
+}
+
+size_t PointStorage::getCount() const {
+	return m_dim == 0 ? 0 : m_points.size() / m_dim;
+}
+
+size_t PointStorage::getLiveCount() const {
+	return getCount() - m_erasedCount;
+}
+
+bool PointStorage::isLive(size_t ind) const {
+	return m_erasedCount == 0 || !m_erased[ind];
+}
+
+void PointStorage::copyPoints(PointStorage const& other) {
+	m_dim = other.m_dim;
+	m_points = other.m_points;
+	m_orderCell = other.m_orderCell;
+	m_eraseMode = other.m_eraseMode;
+	m_erased = other.m_erased;
+	m_erasedCount = other.m_erasedCount;
+	m_filterEnabled = other.m_filterEnabled;
+}
+
+void PointStorage::assignPoints(size_t dim, std::vector<double>& points) {
+	clearPoints();
+	m_points.swap(points);
+	points.clear();
+	m_dim = m_points.empty() ? 0 : dim;
+}
+
+void PointStorage::clearPoints() {
+	m_points.clear();
+	m_dim = 0;
+	m_erased.clear();
+	m_erasedCount = 0;
+	m_filter.clear();
+	m_filterValid = false;
+	pointsRenumbered();
+}
+
+void PointStorage::startPoints(IVector const* vector) {
+	m_dim = vector->getDim();
+	if (m_reservedCount != 0 && m_dim != 0 && m_reservedCount <= m_points.max_size() / m_dim) {
+		m_points.reserve(m_reservedCount * m_dim);
+	}
+	m_points.resize(m_dim);
+	vector->getCoords(0, m_dim, m_points.data());
+	m_filterValid = false;
+	pointsRenumbered();
+}
+
+// tombstones are dropped once they take more than half of the storage
+bool PointStorage::compactionDue() const {
+	return m_erasedCount > getCount() - m_erasedCount;
+}
+
+// a maintained order costs O(n), the later points move and get new numbers
+size_t PointStorage::addPoint(double const* p) {
+	size_t count = getCount();
+	size_t at = count;
+	if (m_orderCell > 0.0) {
+		GridIndex grid;
+		grid.reset(m_dim, m_orderCell);
+		at = grid.mortonUpperBound(m_points.data(), m_dim, count, p);
+	}
+	m_points.insert(m_points.begin() + at * m_dim, p, p + m_dim);
+	if (m_erasedCount != 0) {
+		m_erased.insert(m_erased.begin() + at, false);
+	}
+	if (m_filterValid) {
+		m_filter.add(point(at));
+		m_filterValid = !m_filter.full();
+	}
+	return at;
+}
+
+// moving the last point would break the maintained order
+ISet::EraseMode PointStorage::eraseModeFor() const {
+	if (m_eraseMode == ISet::EraseMode::EM_UNORDERED && m_orderCell > 0.0) {
+		return ISet::EraseMode::EM_ORDERED;
+	}
+	return m_eraseMode;
+}
+
+// an unordered erase renumbers the last point only and a tombstone none,
+// the set patches its lookup structure for them before the call
+void PointStorage::erasePoint(size_t index, ISet::EraseMode mode) {
+	// bits of the point cannot be cleared, the filter is rebuilt by the next query
+	m_filterValid = false;
+	size_t last = getCount() - 1;
+	switch (mode) {
+	case ISet::EraseMode::EM_UNORDERED:
+		if (index != last) {
+			std::copy(m_points.begin() + last * m_dim, m_points.end(), m_points.begin() + index * m_dim);
+		}
+		m_points.resize(last * m_dim);
+		break;
+	case ISet::EraseMode::EM_TOMBSTONE:
+		if (m_erasedCount == 0) {
+			m_erased.assign(getCount(), false);
+		}
+		m_erased[index] = true;
+		++m_erasedCount;
+		if (m_erasedCount == getCount()) {
+			clearPoints();
+		}
+		break;
+	default:
+		m_points.erase(m_points.begin() + index * m_dim, m_points.begin() + (index + 1) * m_dim);
+		pointsRenumbered();
+		break;
+	}
+
+	if (m_points.empty()) {
+		m_dim = 0;
+	}
+}
+
+template<class Action>
+bool PointStorage::eraseMarkedPoints(std::vector<bool> const& marked, Action onTombstone) {
+	size_t count = getCount();
+	m_filterValid = false;
+	if (m_eraseMode == ISet::EraseMode::EM_TOMBSTONE) {
+		bool found = false;
+		for (size_t i = 0; i < count; ++i) {
+			if (marked[i] && isLive(i)) {
+				if (m_erasedCount == 0) {
+					m_erased.assign(count, false);
+				}
+				onTombstone(i);
+				m_erased[i] = true;
+				++m_erasedCount;
+				found = true;
+			}
+		}
+		if (m_erasedCount == count) {
+			clearPoints();
+		}
+		return found;
+	}
+
+	compactPoints(m_points, m_dim, marked);
+	pointsRenumbered();
+
+	if (m_points.empty()) {
+		m_dim = 0;
+	}
+	return getCount() != count;
+}
+
+void PointStorage::dropTombstones() {
+	if (m_erasedCount == 0) {
+		return;
+	}
+
+	compactPoints(m_points, m_dim, m_erased);
+	m_erased.clear();
+	m_erasedCount = 0;
+	pointsRenumbered();
+
+	if (m_points.empty()) {
+		m_dim = 0;
+	}
+}
+
+bool PointStorage::knownEraseMode(ISet::EraseMode mode) const {
+	return mode == ISet::EraseMode::EM_ORDERED || mode == ISet::EraseMode::EM_UNORDERED || mode == ISet::EraseMode::EM_TOMBSTONE;
+}
+
+// switching away from tombstones compacts the storage
+void PointStorage::switchEraseMode(ISet::EraseMode mode) {
+	if (mode != ISet::EraseMode::EM_TOMBSTONE) {
+		dropTombstones();
+	}
+	m_eraseMode = mode;
+}
+
+// an empty set keeps the count until the first insert tells the dimension
+ReturnCode PointStorage::reservePoints(size_t count) {
+	if (m_dim == 0) {
+		m_reservedCount = count;
+		return ReturnCode::RC_SUCCESS;
+	}
+
+	if (count > m_points.max_size() / m_dim) {
+		return ReturnCode::RC_NO_MEM;
+	}
+
+	try {
+		m_points.reserve(count * m_dim);
+		if (m_erasedCount != 0) {
+			m_erased.reserve(count);
+		}
+	}
+	catch (std::bad_alloc const&) {
+		return ReturnCode::RC_NO_MEM;
+	}
+	return ReturnCode::RC_SUCCESS;
+}
+
+void PointStorage::shrinkPoints() {
+	m_reservedCount = 0;
+	m_points.shrink_to_fit();
+	m_erased.shrink_to_fit();
+	m_filter.clear();
+	m_filterValid = false;
+}
+
+// in spatial order mode the maintained order follows the new cell size
+ReturnCode PointStorage::reorderPoints(double cellSize) {
+	if (std::isnan(cellSize)) {
+		return ReturnCode::RC_NAN;
+	}
+
+	if (!(cellSize > 0.0) || std::isinf(cellSize)) {
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	if (m_orderCell > 0.0) {
+		m_orderCell = cellSize;
+	}
+	dropTombstones();
+	size_t count = getCount();
+	if (count < 2) {
+		return ReturnCode::RC_SUCCESS;
+	}
+
+	GridIndex grid;
+	grid.reset(m_dim, cellSize);
+	std::vector<size_t> order(count);
+	for (size_t i = 0; i < count; ++i) {
+		order[i] = i;
+	}
+	grid.mortonSort(m_points.data(), m_dim, order);
+
+	std::vector<double> sorted;
+	sorted.reserve(m_points.capacity());
+	for (size_t i : order) {
+		sorted.insert(sorted.end(), point(i), point(i) + m_dim);
+	}
+	m_points.swap(sorted);
+	pointsRenumbered();
+	return ReturnCode::RC_SUCCESS;
+}
+
+// zero cell size keeps the current order and stops maintaining it
+ReturnCode PointStorage::setPointOrder(double cellSize) {
+	if (cellSize == 0.0) {
+		m_orderCell = 0.0;
+		return ReturnCode::RC_SUCCESS;
+	}
+
+	ReturnCode rc = reorderPoints(cellSize);
+	if (rc == ReturnCode::RC_SUCCESS) {
+		m_orderCell = cellSize;
+	}
+	return rc;
+}
+
+// the filter is rebuilt for the tolerance first if it is stale or sized for another one
+bool PointStorage::filterRejects(double const* query, double tolerance) const {
+	if (!m_filterEnabled || tolerance <= 0.0) {
+		return false;
+	}
+
+	if (!m_filterValid || !m_filter.suits(tolerance)) {
+		size_t count = getCount();
+		// twice the room postpones the next rebuild while the set grows
+		if (!m_filter.reset(m_dim, tolerance, 2 * getLiveCount())) {
+			m_filterValid = false;
+			return false;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			if (isLive(i)) {
+				m_filter.add(point(i));
+			}
+		}
+		m_filterValid = true;
+	}
+
+	return !m_filter.mayContain(query);
+}
+
+void PointStorage::setFilterEnabled(bool enabled) {
+	m_filterEnabled = enabled;
+	if (!enabled) {
+		m_filter.clear();
+		m_filterValid = false;
+	}
+}
+
+ReturnCode PointStorage::visitPoints(ISet::Visitor& visitor) const {
+	size_t count = getCount();
+	for (size_t i = 0; i < count; ++i) {
+		if (isLive(i) && !visitor.visit(i, point(i))) {
+			break;
+		}
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+// all points are stored contiguously, so a block is the run of live points from the cursor
+ReturnCode PointStorage::nextBlock(size_t& cursor, double const*& block, size_t& count) const {
+	block = nullptr;
+	count = 0;
+	size_t total = getCount();
+	while (cursor < total && !isLive(cursor)) {
+		++cursor;
+	}
+	if (cursor >= total) {
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	block = point(cursor);
+	while (cursor < total && isLive(cursor)) {
+		++cursor;
+		++count;
+	}
+	return ReturnCode::RC_SUCCESS;
+}
+
+#endif /* POINT_STORAGE_H */
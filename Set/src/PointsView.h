@@ -0,0 +1,164 @@
+#ifndef POINTS_VIEW_H
+#define POINTS_VIEW_H
+
+#include "../include/ISet.h"
+#include "GridIndex.h"
+#include "PointDistance.h"
+#include <cstddef>	 // size_t
+#include <vector>	 // vector
+#include <algorithm> // copy
+
+namespace {
+	/* declaration */
+	// contiguous row-major view of all points of a set,
+	// points are copied only when the set hands them out in several blocks
+	class PointsView {
+	public:
+		PointsView() = default;
+
+		void init(ISet const* set);
+		double const* point(size_t ind) const;
+		size_t getCount() const;
+		size_t getDim() const;
+
+	private:
+		std::vector<double> m_copy;
+		double const* m_data {nullptr};
+		size_t m_count {0};
+		size_t m_dim {0};
+	};
+}
+
+/* implementation */
+void PointsView::init(ISet const* set) {
+	m_copy.clear();
+	m_data = nullptr;
+	m_count = 0;
+	m_dim = set->getDim();
+
+	size_t cursor = 0;
+	double const* block = nullptr;
+	size_t count = 0;
+	while (set->getBlock(cursor, block, count) == ReturnCode::RC_SUCCESS) {
+		if (m_count == 0 && m_copy.empty()) {
+			m_data = block;
+		}
+		else {
+			if (m_copy.empty()) {
+				m_copy.assign(m_data, m_data + m_count * m_dim);
+			}
+			m_copy.insert(m_copy.end(), block, block + count * m_dim);
+			m_data = m_copy.data();
+		}
+		m_count += count;
+	}
+}
+
+double const* PointsView::point(size_t ind) const {
+	return m_data + ind * m_dim;
+}
+
+size_t PointsView::getCount() const {
+	return m_count;
+}
+
+size_t PointsView::getDim() const {
+	return m_dim;
+}
+
+// flags every point that lies closer than the tolerance to some point of the view.
+// the smaller side is indexed and the larger one probes it, so the pass costs
+// O(count + view size) expected
+static inline size_t markMatches(double const* points, size_t count, PointsView const& view,
+								 IVector::Norm norm, double tolerance, std::vector<bool>& marked) {
+	marked.assign(count, false);
+	if (tolerance <= 0.0 || count == 0 || view.getCount() == 0) {
+		return 0;
+	}
+
+	size_t dim = view.getDim();
+	GridIndex index;
+	index.reset(dim, tolerance);
+	size_t matches = 0;
+	if (count <= view.getCount()) {
+		for (size_t i = 0; i < count; ++i) {
+			index.add(points + i * dim, i);
+		}
+		for (size_t j = 0; j < view.getCount() && matches < count; ++j) {
+			double const* q = view.point(j);
+			index.visit(q, [&](size_t candidate) {
+				if (!marked[candidate] && pointDistance(points + candidate * dim, q, dim, norm) < tolerance) {
+					marked[candidate] = true;
+					++matches;
+				}
+				return false;
+			});
+		}
+		return matches;
+	}
+
+	for (size_t i = 0; i < view.getCount(); ++i) {
+		index.add(view.point(i), i);
+	}
+	for (size_t i = 0; i < count; ++i) {
+		double const* p = points + i * dim;
+		marked[i] = index.visit(p, [&](size_t candidate) {
+			return pointDistance(p, view.point(candidate), dim, norm) < tolerance;
+		});
+		if (marked[i]) {
+			++matches;
+		}
+	}
+	return matches;
+}
+
+// flags points of both views that have a match in the other one, in a single pass:
+// the smaller view is indexed, every point of the larger one probes it
+// and flags itself together with all its matches
+static inline void markMutualMatches(PointsView const& view1, PointsView const& view2, IVector::Norm norm, double tolerance,
+									 std::vector<bool>& marked1, std::vector<bool>& marked2) {
+	marked1.assign(view1.getCount(), false);
+	marked2.assign(view2.getCount(), false);
+	if (tolerance <= 0.0 || view1.getCount() == 0 || view2.getCount() == 0) {
+		return;
+	}
+
+	bool firstIndexed = view1.getCount() <= view2.getCount();
+	PointsView const& indexed = firstIndexed ? view1 : view2;
+	PointsView const& probing = firstIndexed ? view2 : view1;
+	std::vector<bool>& indexedMarks = firstIndexed ? marked1 : marked2;
+	std::vector<bool>& probingMarks = firstIndexed ? marked2 : marked1;
+
+	size_t dim = view1.getDim();
+	GridIndex index;
+	index.reset(dim, tolerance);
+	for (size_t i = 0; i < indexed.getCount(); ++i) {
+		index.add(indexed.point(i), i);
+	}
+	for (size_t j = 0; j < probing.getCount(); ++j) {
+		double const* q = probing.point(j);
+		index.visit(q, [&](size_t candidate) {
+			if (pointDistance(indexed.point(candidate), q, dim, norm) < tolerance) {
+				indexedMarks[candidate] = true;
+				probingMarks[j] = true;
+			}
+			return false;
+		});
+	}
+}
+
+// stable removal of flagged points from a row-major buffer in one pass
+static inline void compactPoints(std::vector<double>& points, size_t dim, std::vector<bool> const& erased) {
+	size_t kept = 0;
+	for (size_t i = 0; i < erased.size(); ++i) {
+		if (!erased[i]) {
+			if (kept != i) {
+				std::copy(points.begin() + i * dim, points.begin() + (i + 1) * dim, points.begin() + kept * dim);
+			}
+			++kept;
+		}
+	}
+	points.resize(kept * dim);
+}
+
+#endif /* POINTS_VIEW_H */
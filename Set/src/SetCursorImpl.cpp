@@ -0,0 +1,130 @@
+#include "../include/ISet.h"
+#include <vector>	 // vector
+#include <new>		 // nothrow
+
+namespace {
+	/* declaration */
+	// streams the result of a set operation as up to two stages played one after another.
+	// a stage walks the blocks of a set or the points of another cursor and passes a point on
+	// when find of the probe set agrees with keepMatched, stages without a probe pass everything.
+	// the state is a block position per stage and one vector for the probes
+	class SetCursorImpl : public ISet::Cursor {
+	private:
+		struct Stage {
+			ISet const* set {nullptr};
+			ISet::Cursor* cursor {nullptr};
+			ISet const* probe {nullptr};
+			bool keepMatched {false};
+			size_t blockCursor {0};
+			double const* block {nullptr};
+			size_t blockCount {0};
+			size_t blockPos {0};
+		};
+
+		Stage m_stages[2];
+		size_t m_stageCount {0};
+		size_t m_current {0};
+		size_t m_dim {0};
+		IVector::Norm m_norm {IVector::Norm::NORM_2};
+		double m_tolerance {0.0};
+		IVector* m_query {nullptr};
+
+		SetCursorImpl(size_t dim, IVector::Norm norm, double tolerance);
+
+		bool nextSource(Stage& stage, double const*& point);
+		bool matches(ISet const* probe, double const* point);
+
+	public:
+		static SetCursorImpl* create(size_t dim, IVector::Norm norm, double tolerance, ILogger* logger);
+		// cursor sources are owned by the result
+		void addStage(ISet const* set, ISet::Cursor* cursor, ISet const* probe, bool keepMatched);
+
+		~SetCursorImpl() override;
+
+		ReturnCode next(double const*& point) override;
+		size_t getDim() const override;
+	};
+}
+
+/* implementation */
+SetCursorImpl::SetCursorImpl(size_t dim, IVector::Norm norm, double tolerance) :
+	m_dim(dim), m_norm(norm), m_tolerance(tolerance) {}
+
+SetCursorImpl* SetCursorImpl::create(size_t dim, IVector::Norm norm, double tolerance, ILogger* logger) {
+	SetCursorImpl* cursor = new(std::nothrow) SetCursorImpl(dim, norm, tolerance);
+	if (cursor == nullptr) {
+		LOG(logger, ReturnCode::RC_NO_MEM);
+		return nullptr;
+	}
+
+	std::vector<double> zeros(dim, 0.0);
+	cursor->m_query = IVector::createVector(dim, zeros.data(), logger);
+	if (cursor->m_query == nullptr) {
+		delete cursor;
+		return nullptr;
+	}
+	return cursor;
+}
+
+void SetCursorImpl::addStage(ISet const* set, ISet::Cursor* cursor, ISet const* probe, bool keepMatched) {
+	Stage& stage = m_stages[m_stageCount++];
+	stage.set = set;
+	stage.cursor = cursor;
+	stage.probe = probe;
+	stage.keepMatched = keepMatched;
+}
+
+SetCursorImpl::~SetCursorImpl() {
+	for (size_t i = 0; i < m_stageCount; ++i) {
+		delete m_stages[i].cursor;
+	}
+	delete m_query;
+}
+
+bool SetCursorImpl::nextSource(Stage& stage, double const*& point) {
+	if (stage.cursor != nullptr) {
+		return stage.cursor->next(point) == ReturnCode::RC_SUCCESS;
+	}
+
+	while (stage.blockPos == stage.blockCount) {
+		if (stage.set->getBlock(stage.blockCursor, stage.block, stage.blockCount) != ReturnCode::RC_SUCCESS) {
+			stage.blockCount = stage.blockPos = 0;
+			return false;
+		}
+		stage.blockPos = 0;
+	}
+	point = stage.block + stage.blockPos * m_dim;
+	++stage.blockPos;
+	return true;
+}
+
+// nothing is closer than zero tolerance, as for the eager operations
+bool SetCursorImpl::matches(ISet const* probe, double const* point) {
+	if (m_tolerance <= 0.0 || probe->getSize() == 0) {
+		return false;
+	}
+
+	size_t ind = 0;
+	m_query->setCoords(0, m_dim, point);
+	return probe->find(m_query, m_norm, m_tolerance, ind) == ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode SetCursorImpl::next(double const*& point) {
+	while (m_current < m_stageCount) {
+		Stage& stage = m_stages[m_current];
+		double const* candidate = nullptr;
+		if (!nextSource(stage, candidate)) {
+			++m_current;
+			continue;
+		}
+		if (stage.probe == nullptr || matches(stage.probe, candidate) == stage.keepMatched) {
+			point = candidate;
+			return ReturnCode::RC_SUCCESS;
+		}
+	}
+	return ReturnCode::RC_OUT_OF_BOUNDS;
+}
+
+size_t SetCursorImpl::getDim() const {
+	return m_dim;
+}
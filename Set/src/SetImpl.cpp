@@ -1,61 +1,137 @@
 #include "../include/ISet.h"
+#include "GridIndex.h"
+#include "LSHIndex.h"
+#include "PointDistance.h"
+#include "PointsView.h"
+#include "PointStorage.h"
 #include <stdlib.h>
-#include <cmath>  // nan, isnan
-#include <vector> // vector
-#include <new>	  // nothrow
+#include <cmath>	 // nan, isnan
+#include <vector>	 // vector
+#include <utility>	 // pair
+#include <algorithm> // partial_sort
+#include <new>		 // nothrow
+#include <mutex>	 // mutex, lock_guard
 
 namespace {
 	/* declaration */
-	class SetImpl : public ISet {
+	class SetImpl : public ISet, private PointStorage {
 	private:
-		size_t m_dim {0};
-		std::vector<IVector*> m_data;
 		ILogger* m_logger {nullptr};
 
+		// lookup index, rebuilt lazily for the tolerance of the query
+		mutable GridIndex m_index;
+		mutable bool m_indexValid {false};
+		// const queries may run in several threads at once, they build and read
+		// the lazy index, the filter and the lookup counters under this lock
+		mutable std::mutex m_lookupLock;
+
+		// approximate index used instead of the grid once configured
+		mutable LSHIndex m_lsh;
+		bool m_scanFallback {false};
+		mutable size_t m_lookups {0};
+		mutable size_t m_fullScans {0};
+
+		void pointsRenumbered() override;
+		void buildIndex(double tolerance, IVector::Norm norm) const;
+		bool prepareIndex(IVector::Norm norm, double tolerance) const;
+		void indexAdd(double const* p, size_t ind) const;
+		void indexRemove(double const* p, size_t ind) const;
+		void indexRelabel(double const* p, size_t from, size_t to) const;
+		void indexShift(size_t first) const;
+		template<class Action>
+		bool indexVisit(double const* p, Action action) const;
+		bool scanRequired(bool found, bool everyMatch = false) const;
+		bool eraseMarked(std::vector<bool> const& marked);
+
 	public:
 		SetImpl();
 		~SetImpl() override;
 
+		// takes over a row-major buffer of distinct points, the buffer is left empty.
+		// a positive tolerance also builds the lookup index for it
+		void assign(size_t dim, std::vector<double>& points, double tolerance = 0.0);
+
+		void useLSH(LSHParams const& params);
+		bool usesLSH() const;
+		void getLSHStats(LSHStats& stats) const;
+
 		ReturnCode insert(IVector const* vector, IVector::Norm norm, double tolerance) 	override;
 		ReturnCode erase(IVector const* vector, IVector::Norm norm, double tolerance) 	override;
 		ReturnCode erase(size_t index) 													override;
+		ReturnCode eraseAll(ISet const* other, IVector::Norm norm, double tolerance) 	override;
 		void clear() 																	override;
+		ReturnCode setEraseMode(EraseMode mode) 										override;
+		void compact() 																	override;
+		ReturnCode setFilter(bool enabled) 												override;
+		ReturnCode reserve(size_t count) 												override;
+		ReturnCode reorder(double cellSize) 											override;
+		ReturnCode setSpatialOrder(double cellSize) 									override;
+		void shrinkToFit() 																override;
 
 		ReturnCode find(IVector const* vector, IVector::Norm norm, double tolerance, size_t& ind) 	const override;
 		ReturnCode get(IVector*& dst, size_t ind) 													const override;
 		size_t getDim() 																			const override;
 		size_t getSize() 																			const override;
 		ISet* clone() 																				const override;
+		void getMemoryUsage(MemoryUsage& usage) 													const override;
+
+		ReturnCode findNearest(IVector const* vector, IVector::Norm norm, size_t k, std::vector<size_t>& inds)         const override;
+		ReturnCode findInRadius(IVector const* vector, IVector::Norm norm, double radius, std::vector<size_t>& inds) const override;
+
+		ReturnCode forEach(Visitor& visitor) 										const override;
+		ReturnCode getBlock(size_t& cursor, double const*& block, size_t& count) 	const override;
 	};
 }
 
 /* implementation */
-SetImpl::SetImpl() :
-	m_dim(0) {
-	m_logger = ILogger::createLogger(this);	
+SetImpl::SetImpl() {
+	m_logger = ILogger::createLogger(this);
 }
 
 SetImpl::~SetImpl() {
-	for (auto it = m_data.begin(); it != m_data.end(); ++it) {
-		delete *it;
-	}
-	m_data.clear();
-	m_dim = 0;
-
 	if (m_logger != nullptr) {
 		m_logger->releaseLogger(this);
 	}
 }
 
+void SetImpl::assign(size_t dim, std::vector<double>& points, double tolerance) {
+	clear();
+	assignPoints(dim, points);
+	if (m_dim != 0 && tolerance > 0.0) {
+		// the grid does not depend on the norm
+		buildIndex(tolerance, IVector::Norm::NORM_2);
+	}
+}
+
+void SetImpl::useLSH(LSHParams const& params) {
+	m_lsh.configure(params.tables, params.projections, params.width, params.seed);
+	m_scanFallback = params.scanFallback;
+	m_index.clear();
+	m_indexValid = false;
+}
+
+bool SetImpl::usesLSH() const {
+	return m_lsh.configured();
+}
+
+void SetImpl::getLSHStats(LSHStats& stats) const {
+	std::lock_guard<std::mutex> lock(m_lookupLock);
+	stats.lookups = m_lookups;
+	stats.fullScans = m_fullScans;
+}
+
+void SetImpl::pointsRenumbered() {
+	m_indexValid = false;
+}
+
 ReturnCode SetImpl::insert(IVector const* vector, IVector::Norm norm, double tolerance) {
 	if (vector == nullptr) {
 		LOG(m_logger, ReturnCode::RC_NULL_PTR);
 		return ReturnCode::RC_NULL_PTR;
 	}
 
-	if (m_data.empty()) {
-		m_data.push_back(vector->clone());
-		m_dim = vector->getDim();
+	if (m_points.empty()) {
+		startPoints(vector);
 		return ReturnCode::RC_SUCCESS;
 	}
 
@@ -74,62 +150,265 @@ ReturnCode SetImpl::insert(IVector const* vector, IVector::Norm norm, double tol
 		return ReturnCode::RC_INVALID_PARAMS;
 	}
 
-	for (auto it = m_data.begin(); it != m_data.end(); ++it) {
-        bool result = false;
-        IVector::equals(*it, vector, norm, tolerance, result, nullptr);
-        if (result == true) {
-            return ReturnCode::RC_SUCCESS;
-        }
+	if (compactionDue()) {
+		compact();
 	}
 
-	m_data.push_back(vector->clone());
+	std::vector<double> query(m_dim);
+	vector->getCoords(0, m_dim, query.data());
+	if (prepareIndex(norm, tolerance) && !filterRejects(query.data(), tolerance)) {
+		bool found = indexVisit(query.data(), [&](size_t ind) {
+			return pointDistance(point(ind), query.data(), m_dim, norm) < tolerance;
+		});
+		if (scanRequired(found)) {
+			for (size_t i = 0; i < getCount() && !found; ++i) {
+				found = isLive(i) && pointDistance(point(i), query.data(), m_dim, norm) < tolerance;
+			}
+		}
+		if (found) {
+			return ReturnCode::RC_SUCCESS;
+		}
+	}
+
+	size_t count = getCount();
+	size_t at = addPoint(query.data());
+	// an index built by earlier queries stays valid for inserts without tolerance too
+	if (m_indexValid) {
+		if (at != count) {
+			indexShift(at);
+		}
+		indexAdd(point(at), at);
+	}
 	return ReturnCode::RC_SUCCESS;
 }
 
+void SetImpl::buildIndex(double tolerance, IVector::Norm norm) const {
+	if (usesLSH()) {
+		m_lsh.reset(m_dim, tolerance, norm);
+	}
+	else {
+		m_index.reset(m_dim, tolerance);
+	}
+	size_t count = getCount();
+	for (size_t i = 0; i < count; ++i) {
+		if (isLive(i)) {
+			indexAdd(point(i), i);
+		}
+	}
+	m_indexValid = true;
+}
+
+void SetImpl::indexAdd(double const* p, size_t ind) const {
+	if (usesLSH()) {
+		m_lsh.add(p, ind);
+	}
+	else {
+		m_index.add(p, ind);
+	}
+}
+
+void SetImpl::indexRemove(double const* p, size_t ind) const {
+	if (usesLSH()) {
+		m_lsh.remove(p, ind);
+	}
+	else {
+		m_index.remove(p, ind);
+	}
+}
+
+void SetImpl::indexRelabel(double const* p, size_t from, size_t to) const {
+	if (usesLSH()) {
+		m_lsh.relabel(p, from, to);
+	}
+	else {
+		m_index.relabel(p, from, to);
+	}
+}
+
+void SetImpl::indexShift(size_t first) const {
+	if (usesLSH()) {
+		m_lsh.shift(first);
+	}
+	else {
+		m_index.shift(first);
+	}
+}
+
+template<class Action>
+bool SetImpl::indexVisit(double const* p, Action action) const {
+	return usesLSH() ? m_lsh.visit(p, action) : m_index.visit(p, action);
+}
+
+// counts lookups of the approximate index, returns true when the caller has to confirm the answer
+// by a full scan: when one found nothing, or always for callers that need every match
+bool SetImpl::scanRequired(bool found, bool everyMatch) const {
+	if (!usesLSH()) {
+		return false;
+	}
+
+	++m_lookups;
+	if ((found && !everyMatch) || !m_scanFallback) {
+		return false;
+	}
+
+	++m_fullScans;
+	return true;
+}
+
+// returns false when no stored point can be closer than the tolerance, otherwise the index is ready
+bool SetImpl::prepareIndex(IVector::Norm norm, double tolerance) const {
+	if (tolerance <= 0.0) {
+		return false;
+	}
+
+	bool suits = usesLSH() ? m_lsh.suits(tolerance, norm) : m_index.suits(tolerance);
+	if (!m_indexValid || !suits) {
+		buildIndex(tolerance, norm);
+	}
+	return true;
+}
+
 ReturnCode SetImpl::erase(size_t index) {
-	if (index >= m_data.size()) {
+	if (index >= getCount()) {
 		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
 		return ReturnCode::RC_OUT_OF_BOUNDS;
 	}
 
-	delete m_data[index];
-	m_data.erase(m_data.begin() + index);
+	if (!isLive(index)) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
 
-	if (m_data.empty()) {
-		m_data.clear();
-		m_dim = 0;
+	// only the moved point changes its number, the index is patched in place.
+	// an ordered erase shifts the later points and drops the index
+	EraseMode mode = eraseModeFor();
+	if (m_indexValid && mode != EraseMode::EM_ORDERED) {
+		size_t last = getCount() - 1;
+		indexRemove(point(index), index);
+		if (mode == EraseMode::EM_UNORDERED && index != last) {
+			indexRelabel(point(last), last, index);
+		}
 	}
+	erasePoint(index, mode);
 
 	return ReturnCode::RC_SUCCESS;
 }
 
+// the index loses tombstoned points one by one, other modes renumber and drop it
+bool SetImpl::eraseMarked(std::vector<bool> const& marked) {
+	return eraseMarkedPoints(marked, [&](size_t i) {
+		if (m_indexValid) {
+			indexRemove(point(i), i);
+		}
+	});
+}
+
+// every match is flagged through the index and removed by one stable compaction
 ReturnCode SetImpl::erase(IVector const* vector, IVector::Norm norm, double tolerance) {
-	size_t ind;
+	if (vector == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (m_points.size() == 0 || m_dim == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	if (m_dim != vector->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	std::vector<double> query(m_dim);
+	vector->getCoords(0, m_dim, query.data());
+	if (!prepareIndex(norm, tolerance) || filterRejects(query.data(), tolerance)) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	std::vector<bool> erased(getCount(), false);
 	bool found = false;
-	ReturnCode rc = ReturnCode::RC_SUCCESS;
-	while (find(vector, norm, tolerance, ind) != ReturnCode::RC_ELEM_NOT_FOUND) {
-		if (rc != ReturnCode::RC_SUCCESS) {
-			LOG(m_logger, rc);
-			return rc;
+	indexVisit(query.data(), [&](size_t candidate) {
+		if (pointDistance(point(candidate), query.data(), m_dim, norm) < tolerance) {
+			erased[candidate] = true;
+			found = true;
 		}
-		found = true;
-		rc = erase(ind);
-		if (rc != ReturnCode::RC_SUCCESS) {
-			return rc;
+		return false;
+	});
+	// buckets may miss some of the matches even when they found others
+	if (scanRequired(found, true)) {
+		for (size_t i = 0; i < getCount(); ++i) {
+			if (isLive(i) && pointDistance(point(i), query.data(), m_dim, norm) < tolerance) {
+				erased[i] = true;
+				found = true;
+			}
 		}
 	}
 
-	return found ? ReturnCode::RC_SUCCESS : ReturnCode::RC_ELEM_NOT_FOUND;
+	if (!found) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	eraseMarked(erased);
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode SetImpl::eraseAll(ISet const* other, IVector::Norm norm, double tolerance) {
+	if (other == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (getCount() == 0 || other->getSize() == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	if (m_dim != other->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	if (std::isnan(tolerance)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (tolerance < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	PointsView view;
+	view.init(other);
+	std::vector<bool> erased;
+	if (markMatches(m_points.data(), getCount(), view, norm, tolerance, erased) == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	return eraseMarked(erased) ? ReturnCode::RC_SUCCESS : ReturnCode::RC_ELEM_NOT_FOUND;
 }
 
+// vectors are created on demand from the flat storage
 ReturnCode SetImpl::get(IVector*& dst, size_t ind) const {
-	if (ind >= m_data.size()) {
+	if (ind >= getCount()) {
 		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
 		return ReturnCode::RC_OUT_OF_BOUNDS;
 	}
 
-	dst = m_data[ind]->clone();
-	return ReturnCode::RC_SUCCESS;
+	if (!isLive(ind)) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	dst = IVector::createVector(m_dim, const_cast<double*>(point(ind)), m_logger);
+	return dst != nullptr ? ReturnCode::RC_SUCCESS : ReturnCode::RC_NO_MEM;
 }
 
 ReturnCode SetImpl::find(IVector const* vector, IVector::Norm norm, double tolerance, size_t& ind) const {
@@ -138,7 +417,7 @@ ReturnCode SetImpl::find(IVector const* vector, IVector::Norm norm, double toler
 		return ReturnCode::RC_NULL_PTR;
 	}
 
-	if (m_data.size() == 0 || m_dim == 0) {
+	if (m_points.size() == 0 || m_dim == 0) {
 		return ReturnCode::RC_ELEM_NOT_FOUND;
 	}
 
@@ -157,16 +436,119 @@ ReturnCode SetImpl::find(IVector const* vector, IVector::Norm norm, double toler
 		return ReturnCode::RC_INVALID_PARAMS;
 	}
 
-	for (auto it = m_data.begin(); it != m_data.end(); ++it) {
-        bool result = false;
-        IVector::equals(*it, vector, norm, tolerance, result, nullptr);
-        if (result == true) {
-			ind = it - m_data.begin();
-			return ReturnCode::RC_SUCCESS;
-        }
+	std::vector<double> query(m_dim);
+	vector->getCoords(0, m_dim, query.data());
+	std::lock_guard<std::mutex> lock(m_lookupLock);
+	if (!prepareIndex(norm, tolerance) || filterRejects(query.data(), tolerance)) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	// the first stored match is reported, as in insertion order
+	bool found = false;
+	indexVisit(query.data(), [&](size_t candidate) {
+		if ((!found || candidate < ind) &&
+			pointDistance(point(candidate), query.data(), m_dim, norm) < tolerance) {
+			ind = candidate;
+			found = true;
+		}
+		return false;
+	});
+	if (scanRequired(found)) {
+		for (size_t i = 0; i < getCount() && !found; ++i) {
+			if (isLive(i) && pointDistance(point(i), query.data(), m_dim, norm) < tolerance) {
+				ind = i;
+				found = true;
+			}
+		}
 	}
 
-	return ReturnCode::RC_ELEM_NOT_FOUND;
+	return found ? ReturnCode::RC_SUCCESS : ReturnCode::RC_ELEM_NOT_FOUND;
+}
+
+// nearest and radius queries scan the whole set, createKDTreeSet is meant for them
+ReturnCode SetImpl::findNearest(IVector const* vector, IVector::Norm norm, size_t k, std::vector<size_t>& inds) const {
+	inds.clear();
+	if (vector == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (m_points.size() == 0 || m_dim == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	if (m_dim != vector->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	std::vector<double> query(m_dim);
+	vector->getCoords(0, m_dim, query.data());
+	size_t count = getCount();
+	std::vector<std::pair<double, size_t>> distances;
+	distances.reserve(getLiveCount());
+	for (size_t i = 0; i < count; ++i) {
+		if (isLive(i)) {
+			distances.push_back(std::make_pair(pointDistance(point(i), query.data(), m_dim, norm), i));
+		}
+	}
+
+	if (k > distances.size()) {
+		k = distances.size();
+	}
+	std::partial_sort(distances.begin(), distances.begin() + k, distances.end());
+	inds.resize(k);
+	for (size_t i = 0; i < k; ++i) {
+		inds[i] = distances[i].second;
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode SetImpl::findInRadius(IVector const* vector, IVector::Norm norm, double radius, std::vector<size_t>& inds) const {
+	inds.clear();
+	if (vector == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (m_points.size() == 0 || m_dim == 0) {
+		return ReturnCode::RC_ELEM_NOT_FOUND;
+	}
+
+	if (m_dim != vector->getDim()) {
+		LOG(m_logger, ReturnCode::RC_WRONG_DIM);
+		return ReturnCode::RC_WRONG_DIM;
+	}
+
+	if (std::isnan(radius)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	if (radius < 0) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	std::vector<double> query(m_dim);
+	vector->getCoords(0, m_dim, query.data());
+	size_t count = getCount();
+	for (size_t i = 0; i < count; ++i) {
+		if (isLive(i) && pointDistance(point(i), query.data(), m_dim, norm) <= radius) {
+			inds.push_back(i);
+		}
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode SetImpl::forEach(Visitor& visitor) const {
+	return visitPoints(visitor);
+}
+
+ReturnCode SetImpl::getBlock(size_t& cursor, double const*& block, size_t& count) const {
+	return nextBlock(cursor, block, count);
 }
 
 size_t SetImpl::getDim() const {
@@ -174,7 +556,7 @@ size_t SetImpl::getDim() const {
 }
 
 size_t SetImpl::getSize() const {
-	return m_data.size();
+	return getLiveCount();
 }
 
 ISet* SetImpl::clone() const {
@@ -184,18 +566,75 @@ ISet* SetImpl::clone() const {
 		return nullptr;
 	}
 
-	set->m_dim = m_dim;
-	for (auto it = m_data.begin(); it < m_data.end(); ++it) {
-		set->m_data.push_back((*it)->clone());
-	}
+	set->copyPoints(*this);
+	std::lock_guard<std::mutex> lock(m_lookupLock);
+	set->m_lsh = m_lsh;
+	set->m_lsh.clear();
+	set->m_scanFallback = m_scanFallback;
 
 	return set;
 }
 
+// the index configuration survives clear as the storage settings do
 void SetImpl::clear() {
-	for (auto it = m_data.begin(); it != m_data.end(); ++it) {
-		delete *it;
+	m_index.clear();
+	m_lsh.clear();
+	clearPoints();
+}
+
+ReturnCode SetImpl::setEraseMode(EraseMode mode) {
+	if (!knownEraseMode(mode)) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	switchEraseMode(mode);
+	return ReturnCode::RC_SUCCESS;
+}
+
+void SetImpl::compact() {
+	dropTombstones();
+}
+
+ReturnCode SetImpl::setFilter(bool enabled) {
+	setFilterEnabled(enabled);
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode SetImpl::reserve(size_t count) {
+	ReturnCode rc = reservePoints(count);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(m_logger, rc);
+	}
+	return rc;
+}
+
+void SetImpl::shrinkToFit() {
+	shrinkPoints();
+	m_index.clear();
+	m_lsh.clear();
+	m_indexValid = false;
+}
+
+void SetImpl::getMemoryUsage(MemoryUsage& usage) const {
+	std::lock_guard<std::mutex> lock(m_lookupLock);
+	usage.points = m_points.capacity() * sizeof(double);
+	usage.index = m_index.memoryUsage() + m_lsh.memoryUsage() + m_filter.memoryUsage();
+	usage.overhead = sizeof(*this) + m_erased.capacity() / 8;
+}
+
+ReturnCode SetImpl::reorder(double cellSize) {
+	ReturnCode rc = reorderPoints(cellSize);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(m_logger, rc);
+	}
+	return rc;
+}
+
+ReturnCode SetImpl::setSpatialOrder(double cellSize) {
+	ReturnCode rc = setPointOrder(cellSize);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(m_logger, rc);
 	}
-	m_data.clear();
-	m_dim = 0;
+	return rc;
 }
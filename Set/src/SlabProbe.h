@@ -0,0 +1,124 @@
+#ifndef SLAB_PROBE_H
+#define SLAB_PROBE_H
+
+#include "GridIndex.h"
+#include "PointDistance.h"
+#include "PointsView.h"
+#include <cstddef>		// size_t
+#include <cmath>		// fabs, isnan
+#include <cfloat>		// DBL_EPSILON
+#include <vector>		// vector
+#include <algorithm>	// nth_element, upper_bound, sort, unique
+#include <atomic>		// atomic
+#include <thread>		// thread
+#include <system_error>	// system_error
+
+// slabs per worker, smaller slabs even out the load of dense regions
+static size_t const SLABS_PER_THREAD = 4;
+
+// number of the slab [splits[k - 1], splits[k]) holding the coordinate
+static inline size_t slabOf(std::vector<double> const& splits, double x) {
+	return (size_t)(std::upper_bound(splits.begin(), splits.end(), x) - splits.begin());
+}
+
+// calls action(probeInd, referenceInd) for every pair of selected points closer than the tolerance.
+// the space is cut into slabs along the first coordinate at quantiles of the probing points,
+// every slab gets the reference points within a tolerance-wide halo and is matched on its own grid.
+// slabs are processed by a pool of threads, all pairs of one probing point are reported by one thread,
+// so the action may write to per-probe state without locking.
+// an empty selection mask selects every point
+template<class Action>
+static void probeSlabs(PointsView const& probe, std::vector<char> const& probeMask,
+					   PointsView const& reference, std::vector<char> const& referenceMask,
+					   IVector::Norm norm, double tolerance, size_t threads, Action action) {
+	if (tolerance <= 0.0 || probe.getCount() == 0 || reference.getCount() == 0) {
+		return;
+	}
+
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+		if (threads == 0) {
+			threads = 1;
+		}
+	}
+
+	std::vector<double> keys;
+	keys.reserve(probe.getCount());
+	for (size_t i = 0; i < probe.getCount(); ++i) {
+		if ((probeMask.empty() || probeMask[i]) && !std::isnan(probe.point(i)[0])) {
+			keys.push_back(probe.point(i)[0]);
+		}
+	}
+
+	size_t slabs = threads == 1 ? 1 : threads * SLABS_PER_THREAD;
+	std::vector<double> splits;
+	for (size_t k = 1; k < slabs && !keys.empty(); ++k) {
+		std::vector<double>::iterator nth = keys.begin() + keys.size() * k / slabs;
+		std::nth_element(keys.begin(), nth, keys.end());
+		splits.push_back(*nth);
+	}
+	std::sort(splits.begin(), splits.end());
+	splits.erase(std::unique(splits.begin(), splits.end()), splits.end());
+	slabs = splits.size() + 1;
+
+	std::vector<std::vector<size_t>> probes(slabs), references(slabs);
+	for (size_t i = 0; i < probe.getCount(); ++i) {
+		if (probeMask.empty() || probeMask[i]) {
+			probes[slabOf(splits, probe.point(i)[0])].push_back(i);
+		}
+	}
+	for (size_t i = 0; i < reference.getCount(); ++i) {
+		double x = reference.point(i)[0];
+		if ((!referenceMask.empty() && !referenceMask[i]) || std::isnan(x)) {
+			continue;
+		}
+		// the halo also covers rounding of x -+ halo
+		double halo = tolerance * GRID_CELL_MARGIN + std::fabs(x) * 4.0 * DBL_EPSILON;
+		size_t last = slabOf(splits, x + halo);
+		for (size_t k = slabOf(splits, x - halo); k <= last; ++k) {
+			references[k].push_back(i);
+		}
+	}
+
+	size_t dim = probe.getDim();
+	std::atomic<size_t> next(0);
+	auto work = [&]() {
+		GridIndex index;
+		for (size_t k = next++; k < slabs; k = next++) {
+			std::vector<size_t> const& refs = references[k];
+			if (refs.empty() || probes[k].empty()) {
+				continue;
+			}
+			index.reset(dim, tolerance);
+			for (size_t j = 0; j < refs.size(); ++j) {
+				index.add(reference.point(refs[j]), j);
+			}
+			for (size_t p : probes[k]) {
+				double const* q = probe.point(p);
+				index.visit(q, [&](size_t candidate) {
+					if (pointDistance(q, reference.point(refs[candidate]), dim, norm) < tolerance) {
+						action(p, refs[candidate]);
+					}
+					return false;
+				});
+			}
+		}
+	};
+
+	// the calling thread is one of the workers, the pool shrinks if threads cannot be started
+	std::vector<std::thread> pool;
+	for (size_t t = 1; t < threads && t < slabs; ++t) {
+		try {
+			pool.emplace_back(work);
+		}
+		catch (std::system_error const&) {
+			break;
+		}
+	}
+	work();
+	for (std::thread& thread : pool) {
+		thread.join();
+	}
+}
+
+#endif /* SLAB_PROBE_H */
@@ -7,6 +7,7 @@
 #include "../../Logger/include/ILogger.h"
 #include "../../Vector/include/IVector.h"
 #include "../../Compact/include/ICompact.h"
+#include "../../Compact/include/ICompactCollection.h"
 
 #include <assert.h> // assert
 #include <cstddef>	// size_t
@@ -209,6 +210,15 @@ bool testICompact(bool useLogger) {
 		IVector::equals(vec3_end_2, get_vec3_end_2, norm, tolerance, res, logger) == ReturnCode::RC_SUCCESS &&
 		res == true);
 
+	// views are the corners kept by the compact, not copies
+	outputTest("getBeginView",
+		comp3_1->getBeginView() == comp3_1->getBeginView() 											 &&
+		IVector::equals(vec3_beg_1, comp3_1->getBeginView(), norm, tolerance, res, logger) == ReturnCode::RC_SUCCESS &&
+		res == true																					 &&
+		IVector::equals(vec3_end_1, comp3_1->getEndView(), norm, tolerance, res, logger) == ReturnCode::RC_SUCCESS 	 &&
+		res == true,
+		true);
+
 	ICompact* clone_1 = comp1_1->clone();
 	ICompact* clone_2 = comp2_1->clone();
 	ICompact* clone_3 = comp3_1->clone();
@@ -415,6 +425,38 @@ bool testICompact(bool useLogger) {
 		flag_not_contains_3_beg == true &&
 		flag_not_contains_3_end == false);
 
+	// batch contains agrees with contains point by point, across several mask words
+	std::vector<double> batch_points;
+	for (size_t i = 0; i < 150; ++i) {
+		batch_points.push_back(-0.5 + 0.013 * (double)i);
+		batch_points.push_back(i % 3 == 0 ? 1.5 : 0.5);
+	}
+	std::vector<unsigned long long> batch_mask(3, 0);
+	std::vector<size_t> batch_inds;
+	bool batch_same =
+		comp2_1->contains(batch_points.data(), 150, batch_mask.data()) == ReturnCode::RC_SUCCESS &&
+		comp2_1->contains(batch_points.data(), 150, batch_inds) == ReturnCode::RC_SUCCESS &&
+		!batch_inds.empty();
+	size_t batch_next = 0;
+	for (size_t i = 0; batch_same && i < 150; ++i) {
+		IVector* batch_vec = IVector::createVector(2, batch_points.data() + 2 * i, logger);
+		bool batch_flag = false;
+		bool masked = (batch_mask[i / 64] >> (i % 64) & 1) != 0;
+		bool listed = batch_next < batch_inds.size() && batch_inds[batch_next] == i;
+		batch_same = batch_vec != nullptr &&
+			comp2_1->contains(batch_vec, batch_flag) == ReturnCode::RC_SUCCESS &&
+			batch_flag == masked &&
+			batch_flag == listed;
+		batch_next += listed ? 1 : 0;
+		delete batch_vec;
+	}
+	outputTest("contains (batch)",
+		batch_same && batch_next == batch_inds.size(),
+		true);
+
+	outputTest("contains (batch)",
+		comp2_1->contains(nullptr, 150, batch_mask.data()) == ReturnCode::RC_NULL_PTR);	// record will be added to logfile
+
 	ICompact* subset_comp1_1 = ICompact::createCompact(contains_vec1_beg_1, contains_vec1_end_1, tolerance, logger);
 	ICompact* subset_comp2_1 = ICompact::createCompact(contains_vec2_beg_1, contains_vec2_end_1, tolerance, logger);
 	ICompact* subset_comp3_1 = ICompact::createCompact(contains_vec3_beg_1, contains_vec3_end_1, tolerance, logger);
@@ -762,6 +804,175 @@ bool testICompact(bool useLogger) {
 	temp11 = nullptr;
 	temp12 = nullptr;
 
+	// ICompactCollection, the union of disjoint boxes is kept as both of them
+	ICompactCollection* collection = ICompactCollection::_union(comp2_1, comp2_2, tolerance, logger);
+	double collection_data[8] = {2.5, 2.5, 1.5, 1.5, 0.0, 0.0, 3.0, 3.0};
+	IVector* collection_in  = IVector::createVector(2, collection_data, logger);
+	IVector* collection_out = IVector::createVector(2, collection_data + 2, logger);
+	IVector* collection_beg = IVector::createVector(2, collection_data + 4, logger);
+	IVector* collection_end = IVector::createVector(2, collection_data + 6, logger);
+	assert(collection_in != nullptr && collection_out != nullptr && collection_beg != nullptr && collection_end != nullptr);
+	ICompact* collection_span = ICompact::createCompact(collection_beg, collection_end, tolerance, logger);
+	assert(collection_span != nullptr);
+	bool collection_contains = false;
+	bool collection_not_contains = true;
+	bool collection_intersects = false;
+	bool collection_covers = true;
+	outputTest("ICompactCollection",
+		collection != nullptr &&
+		collection->getCount() == 2 &&
+		collection->contains(collection_in, collection_contains) == ReturnCode::RC_SUCCESS &&
+		collection->contains(collection_out, collection_not_contains) == ReturnCode::RC_SUCCESS &&
+		collection->intersects(collection_span, collection_intersects) == ReturnCode::RC_SUCCESS &&
+		collection->covers(collection_span, collection_covers) == ReturnCode::RC_SUCCESS &&
+		collection_contains &&
+		!collection_not_contains &&
+		collection_intersects &&
+		!collection_covers,
+		true);
+
+	// two bridges fill the gap, the span is covered though no single box holds it
+	double bridge_data[8] = {1.0, 0.0, 3.0, 2.0, 0.0, 1.0, 2.0, 3.0};
+	bool collection_subset = false;
+	bool collection_not_subset = true;
+	for (size_t i = 0; i < 2; ++i) {
+		IVector* bridge_beg = IVector::createVector(2, bridge_data + 4 * i, logger);
+		IVector* bridge_end = IVector::createVector(2, bridge_data + 4 * i + 2, logger);
+		ICompact* bridge = ICompact::createCompact(bridge_beg, bridge_end, tolerance, logger);
+		if (collection != nullptr) {
+			collection->add(bridge);
+		}
+		delete bridge;
+		delete bridge_beg;
+		delete bridge_end;
+	}
+	outputTest("ICompactCollection",
+		collection != nullptr &&
+		collection->getCount() == 4 &&
+		collection->covers(collection_span, collection_covers) == ReturnCode::RC_SUCCESS &&
+		collection->isSubset(collection_span, collection_subset) == ReturnCode::RC_SUCCESS &&
+		collection->isSubset(comp2_1, collection_not_subset) == ReturnCode::RC_SUCCESS &&
+		collection_covers &&
+		collection_subset &&
+		!collection_not_subset);
+
+	outputTest("ICompactCollection",
+		collection != nullptr &&
+		collection->add(comp1_1) == ReturnCode::RC_WRONG_DIM &&	// record will be added to logfile
+		ICompactCollection::createCollection(0, tolerance, logger) == nullptr);	// record will be added to logfile
+
+	// enough boxes for the R-tree to be built, every answer is checked against a scan of all boxes.
+	// a 10x10 grid of unit cells is added first, the rest are scattered over and around it
+	ICompactCollection* many = ICompactCollection::createCollection(2, tolerance, logger);
+	assert(many != nullptr);
+	std::vector<double> many_boxes;
+	size_t const many_count = 400;
+	for (size_t j = 0; j < many_count; ++j) {
+		double box_data[4];
+		if (j < 100) {
+			box_data[0] = (double)(j % 10);
+			box_data[1] = (double)(j / 10);
+			box_data[2] = box_data[0] + 1.0;
+			box_data[3] = box_data[1] + 1.0;
+		}
+		else {
+			box_data[0] = (double)((j * 37) % 120) * 0.1 - 1.0;
+			box_data[1] = (double)((j * 61) % 120) * 0.1 - 1.0;
+			box_data[2] = box_data[0] + 0.2 + (double)(j % 5) * 0.1;
+			box_data[3] = box_data[1] + 0.2 + (double)(j % 7) * 0.1;
+		}
+		IVector* box_beg = IVector::createVector(2, box_data, logger);
+		IVector* box_end = IVector::createVector(2, box_data + 2, logger);
+		assert(box_beg != nullptr && box_end != nullptr);
+		ICompact* box = ICompact::createCompact(box_beg, box_end, tolerance, logger);
+		assert(box != nullptr);
+		many->add(box);
+		many_boxes.insert(many_boxes.end(), box_data, box_data + 4);
+		delete box;
+		delete box_beg;
+		delete box_end;
+	}
+	bool many_match = many->getCount() == many_count;
+	for (size_t q = 0; q < 900 && many_match; ++q) {
+		// every fourth query is a point, the others are boxes of several sizes
+		double query_data[4];
+		query_data[0] = (double)((q * 53) % 140) * 0.1 - 2.0;
+		query_data[1] = (double)((q * 29) % 140) * 0.1 - 2.0;
+		query_data[2] = query_data[0] + (double)(q % 4) * 0.15;
+		query_data[3] = q % 4 == 0 ? query_data[1] : query_data[1] + 0.05 + (double)(q % 3) * 0.15;
+		bool expected = false;
+		for (size_t j = 0; j < many_count && !expected; ++j) {
+			double const* b = many_boxes.data() + 4 * j;
+			expected = query_data[0] <= b[2] && b[0] <= query_data[2] && query_data[1] <= b[3] && b[1] <= query_data[3];
+		}
+		IVector* query_beg = IVector::createVector(2, query_data, logger);
+		IVector* query_end = IVector::createVector(2, query_data + 2, logger);
+		assert(query_beg != nullptr && query_end != nullptr);
+		bool found = !expected;
+		if (q % 4 == 0) {
+			many_match = many->contains(query_beg, found) == ReturnCode::RC_SUCCESS && found == expected;
+		}
+		else {
+			ICompact* query = ICompact::createCompact(query_beg, query_end, 0.0, logger);
+			assert(query != nullptr);
+			many_match = many->intersects(query, found) == ReturnCode::RC_SUCCESS && found == expected;
+			delete query;
+		}
+		delete query_beg;
+		delete query_end;
+	}
+	double grid_data[6] = {0.0, 0.0, 10.0, 10.0, 13.0, 13.0};
+	IVector* grid_beg = IVector::createVector(2, grid_data, logger);
+	IVector* grid_end = IVector::createVector(2, grid_data + 2, logger);
+	IVector* grid_out = IVector::createVector(2, grid_data + 4, logger);
+	assert(grid_beg != nullptr && grid_end != nullptr && grid_out != nullptr);
+	ICompact* grid = ICompact::createCompact(grid_beg, grid_end, tolerance, logger);
+	ICompact* grid_over = ICompact::createCompact(grid_beg, grid_out, tolerance, logger);
+	assert(grid != nullptr && grid_over != nullptr);
+	bool grid_covered = false;
+	bool grid_over_covered = true;
+	ICompactCollection* many_copy = many->clone();
+	outputTest("ICompactCollection (many boxes)",
+		many_match &&
+		many->covers(grid, grid_covered) == ReturnCode::RC_SUCCESS &&
+		many->covers(grid_over, grid_over_covered) == ReturnCode::RC_SUCCESS &&
+		grid_covered &&
+		!grid_over_covered &&
+		many_copy != nullptr &&
+		many_copy->getCount() == many_count,
+		true);
+	delete many_copy;
+	delete grid;
+	delete grid_over;
+	delete grid_beg;
+	delete grid_end;
+	delete grid_out;
+	delete many;
+
+	// findOverlaps, touching boxes meet: only the two first boxes are apart
+	std::vector<std::pair<size_t, size_t>> overlaps;
+	std::vector<std::pair<size_t, size_t>> collection_overlaps = {{0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}};
+	outputTest("findOverlaps",
+		collection != nullptr &&
+		collection->findOverlaps(overlaps) == ReturnCode::RC_SUCCESS &&
+		overlaps == collection_overlaps,
+		true);
+
+	std::vector<std::pair<size_t, size_t>> span_overlaps = {{0, 2}, {1, 2}};
+	outputTest("findOverlaps",
+		ICompact::findOverlaps({comp2_1, comp2_2, collection_span}, overlaps, logger) == ReturnCode::RC_SUCCESS &&
+		overlaps == span_overlaps);
+
+	outputTest("findOverlaps",
+		ICompact::findOverlaps({comp2_1, comp1_1}, overlaps, logger) == ReturnCode::RC_WRONG_DIM &&	// record will be added to logfile
+		overlaps.empty());
+	delete collection;
+	delete collection_span;
+	delete collection_in;
+	delete collection_out;
+	delete collection_beg;
+	delete collection_end;
+
 	double* step_1 = new (std::nothrow) double[dim1];
 	double* step_2 = new (std::nothrow) double[dim2];
 	double* step_3 = new (std::nothrow) double[dim3];
@@ -12,6 +12,9 @@
 #include <assert.h> // assert
 #include <new>		// nothrow
 #include <iostream> // cout
+#include <vector>	// vector
+#include <cmath>	// fabs (C++11)
+#include <thread>	// thread
 
 // static void printSet(ISet const* s) {
 // 	if (s == nullptr)
@@ -27,6 +30,44 @@
 // 	std::cout << '\n';
 // }
 
+namespace {
+	class CountingVisitor : public ISet::Visitor {
+	public:
+		size_t m_count {0};
+		double m_sum {0.0};
+		size_t m_dim {0};
+
+		bool visit(size_t ind, double const* point) override {
+			++m_count;
+			for (size_t i = 0; i < m_dim; ++i) {
+				m_sum += point[i];
+			}
+			return true;
+		}
+	};
+
+	// the cursor hands out exactly the points of the set, in its order
+	bool sameStream(ISet::Cursor* cursor, ISet const* set) {
+		if (cursor == nullptr || set == nullptr) {
+			return false;
+		}
+		double const* point = nullptr;
+		for (size_t i = 0; i < set->getSize(); ++i) {
+			IVector* vec = nullptr;
+			bool same = cursor->next(point) == ReturnCode::RC_SUCCESS &&
+				set->get(vec, i) == ReturnCode::RC_SUCCESS;
+			for (size_t j = 0; same && j < set->getDim(); ++j) {
+				same = vec->getCoord(j) == point[j];
+			}
+			delete vec;
+			if (!same) {
+				return false;
+			}
+		}
+		return cursor->next(point) == ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+}
+
 bool testISet(bool useLogger) {
 	void* client	= nullptr;
 	ILogger* logger = nullptr;
@@ -183,6 +224,471 @@ bool testISet(bool useLogger) {
 	outputTest("find",
 		set1->find(vec3, norm, tolerance, ind) != ReturnCode::RC_SUCCESS);
 
+	// ISet::insert, ISet::find on many points
+	ISet* set11 = ISet::createSet(logger);
+	assert(set11 != nullptr);
+	double point[3] = {0.0, 0.0, 0.0};
+	for (size_t i = 0; i < 1000; ++i) {
+		point[0] = (double)(i % 10);
+		point[1] = (double)(i / 10 % 10);
+		point[2] = (double)(i / 100);
+		IVector* vec = IVector::createVector(dim1, point, logger);
+		assert(vec != nullptr);
+		set11->insert(vec, norm, tolerance);
+		delete vec;
+	}
+	bool manyFound = true;
+	for (size_t i = 0; i < 1000; ++i) {
+		point[0] = (double)(i % 10) + 0.01;
+		point[1] = (double)(i / 10 % 10) - 0.01;
+		point[2] = (double)(i / 100);
+		IVector* vec = IVector::createVector(dim1, point, logger);
+		assert(vec != nullptr);
+		manyFound = manyFound &&
+			set11->insert(vec, norm, tolerance) == ReturnCode::RC_SUCCESS &&
+			set11->find(vec, norm, tolerance, ind) == ReturnCode::RC_SUCCESS &&
+			ind == i;
+		delete vec;
+	}
+	outputTest("insert (many)",
+		manyFound &&
+		set11->getSize() == 1000,
+		true);
+
+	// a point inserted without tolerance joins the index built by the first find
+	ISet* set11Index = set11->clone();
+	assert(set11Index != nullptr);
+	point[0] = point[1] = point[2] = 0.5;
+	IVector* vecIndex = IVector::createVector(dim1, point, logger);
+	assert(vecIndex != nullptr);
+	outputTest("insert (many)",
+		set11Index->find(vecIndex, norm, tolerance, ind) == ReturnCode::RC_ELEM_NOT_FOUND &&
+		set11Index->insert(vecIndex, norm, 0.0) == ReturnCode::RC_SUCCESS &&
+		set11Index->find(vecIndex, norm, tolerance, ind) == ReturnCode::RC_SUCCESS &&
+		ind == 1000 &&
+		set11Index->insert(vecIndex, norm, tolerance) == ReturnCode::RC_SUCCESS &&
+		set11Index->getSize() == 1001);
+	delete vecIndex;
+	delete set11Index;
+
+	// ISet::createSet from a block of points, every point comes with a near duplicate
+	std::vector<double> bulkPoints;
+	for (size_t i = 0; i < 2000; ++i) {
+		size_t j = i / 2;
+		bulkPoints.push_back((double)(j % 10) + (i % 2 == 0 ? 0.0 : 0.01));
+		bulkPoints.push_back((double)(j / 10 % 10));
+		bulkPoints.push_back((double)(j / 100));
+	}
+	ISet* bulkSet = ISet::createSet(dim1, 2000, bulkPoints.data(), norm, tolerance, logger);
+	bool bulkFound = bulkSet != nullptr && bulkSet->getSize() == 1000;
+	for (size_t i = 0; bulkFound && i < 1000; ++i) {
+		IVector* vec = nullptr;
+		size_t bulkInd = 0;
+		bulkFound = set11->get(vec, i) == ReturnCode::RC_SUCCESS &&
+			bulkSet->find(vec, norm, tolerance, bulkInd) == ReturnCode::RC_SUCCESS;
+		delete vec;
+	}
+	outputTest("createSet (bulk)",
+		bulkFound,
+		true);
+	delete bulkSet;
+
+	outputTest("createSet (bulk)",
+		ISet::createSet(dim1, 2000, nullptr, norm, tolerance, logger) == nullptr &&	// record will be added to logfile
+		ISet::createSet(dim1, 2000, bulkPoints.data(), norm, -1.0, logger) == nullptr);		// record will be added to logfile
+
+	// nan coordinates are refused as createVector refuses them, so is a block too large to copy
+	bulkPoints[4] = std::nan("");
+	outputTest("createSet (bulk)",
+		ISet::createSet(dim1, 2000, bulkPoints.data(), norm, tolerance, logger) == nullptr &&	// record will be added to logfile
+		ISet::createSet(dim1, 2000, bulkPoints.data(), norm, 0.0, logger) == nullptr &&		// record will be added to logfile
+		ISet::createSet(dim1, (size_t)-1 / 2, bulkPoints.data(), norm, tolerance, logger) == nullptr);	// record will be added to logfile
+
+	// ISet::saveSet, ISet::createMappedSet
+	char const* setFile = "ISet.bin";
+	outputTest("saveSet",
+		ISet::saveSet(set11, setFile, tolerance, logger) == ReturnCode::RC_SUCCESS,
+		true);
+
+	outputTest("saveSet",
+		ISet::saveSet(set11, setFile, -1.0, logger) != ReturnCode::RC_SUCCESS);	// record will be added to logfile
+
+	ISet* mappedSet = ISet::createMappedSet(setFile, logger);
+	bool mappedFound = mappedSet != nullptr && mappedSet->getSize() == set11->getSize();
+	for (size_t i = 0; mappedFound && i < set11->getSize(); ++i) {
+		IVector* vec = nullptr;
+		size_t mappedInd = 0;
+		mappedFound = set11->get(vec, i) == ReturnCode::RC_SUCCESS &&
+			mappedSet->find(vec, norm, tolerance, mappedInd) == ReturnCode::RC_SUCCESS &&
+			mappedInd == i;
+		delete vec;
+	}
+	outputTest("createMappedSet",
+		mappedFound,
+		true);
+
+	// a clone of the mapped set gets the grid of the file at once and keeps the filter switch:
+	// a miss leaves the grid of a plain clone as it was and builds the filter of a filtered one
+	point[0] = 0.5;
+	point[1] = point[2] = 0.0;
+	IVector* mappedMiss = IVector::createVector(dim1, point, logger);
+	assert(mappedMiss != nullptr);
+	ISet* mappedClones[2] = {nullptr, nullptr};
+	ISet::MemoryUsage clonedUsage[2], missedUsage[2];
+	bool mappedMissed = mappedSet != nullptr;
+	for (size_t i = 0; mappedMissed && i < 2; ++i) {
+		mappedClones[i] = mappedSet->setFilter(i == 1) == ReturnCode::RC_SUCCESS ? mappedSet->clone() : nullptr;
+		mappedMissed = mappedClones[i] != nullptr &&
+			mappedClones[i]->getSize() == set11->getSize();
+		if (mappedMissed) {
+			mappedClones[i]->getMemoryUsage(clonedUsage[i]);
+			mappedMissed = mappedClones[i]->find(mappedMiss, norm, tolerance, ind) == ReturnCode::RC_ELEM_NOT_FOUND;
+			mappedClones[i]->getMemoryUsage(missedUsage[i]);
+		}
+	}
+	outputTest("createMappedSet",
+		mappedMissed &&
+		clonedUsage[0].index == missedUsage[0].index &&
+		clonedUsage[1].index == missedUsage[0].index &&
+		missedUsage[1].index > missedUsage[0].index);
+	delete mappedClones[0];
+	delete mappedClones[1];
+	delete mappedMiss;
+
+	outputTest("createMappedSet",
+		mappedSet != nullptr &&
+		mappedSet->find(vec1, norm, tolerance, ind) != ReturnCode::RC_SUCCESS &&
+		mappedSet->insert(vec1, norm, tolerance) == ReturnCode::RC_SUCCESS &&
+		mappedSet->getSize() == set11->getSize() + 1 &&
+		mappedSet->find(vec1, norm, tolerance, ind) == ReturnCode::RC_SUCCESS &&
+		ind == set11->getSize());
+	delete mappedSet;
+
+	outputTest("createMappedSet",
+		ISet::createMappedSet("ISet.missing", logger) == nullptr);	// record will be added to logfile
+
+	// ISet::setFilter, points between the grid nodes are definite misses
+	ISet* filteredSet = set11->clone();
+	bool filteredSame = filteredSet != nullptr && filteredSet->setFilter(true) == ReturnCode::RC_SUCCESS;
+	for (size_t i = 0; filteredSame && i < set11->getSize(); ++i) {
+		IVector* vec = nullptr;
+		size_t filteredInd = 0;
+		filteredSame = set11->get(vec, i) == ReturnCode::RC_SUCCESS &&
+			filteredSet->find(vec, norm, tolerance, filteredInd) == ReturnCode::RC_SUCCESS &&
+			filteredInd == i &&
+			vec->setCoord(0, vec->getCoord(0) + 0.5) == ReturnCode::RC_SUCCESS &&
+			filteredSet->find(vec, norm, tolerance, filteredInd) == ReturnCode::RC_ELEM_NOT_FOUND;
+		delete vec;
+	}
+	outputTest("setFilter",
+		filteredSame,
+		true);
+
+	IVector* filteredVec = nullptr;
+	outputTest("setFilter",
+		filteredSet != nullptr &&
+		filteredSet->get(filteredVec, 0) == ReturnCode::RC_SUCCESS &&
+		filteredSet->erase((size_t)0) == ReturnCode::RC_SUCCESS &&
+		filteredSet->find(filteredVec, norm, tolerance, ind) == ReturnCode::RC_ELEM_NOT_FOUND &&
+		filteredSet->insert(filteredVec, norm, tolerance) == ReturnCode::RC_SUCCESS &&
+		filteredSet->find(filteredVec, norm, tolerance, ind) == ReturnCode::RC_SUCCESS);
+	delete filteredVec;
+	delete filteredSet;
+
+	// ISet::reserve, ISet::shrinkToFit, ISet::getMemoryUsage
+	ISet* reservedSets[3] = {ISet::createSet(logger), ISet::createKDTreeSet(logger), ISet::createConcurrentSet(tolerance, logger)};
+	bool reservedFits = true;
+	for (size_t i = 0; i < 3; ++i) {
+		ISet::MemoryUsage reservedUsage, shrunkUsage;
+		reservedFits = reservedFits &&
+			reservedSets[i] != nullptr &&
+			reservedSets[i]->reserve(5000) == ReturnCode::RC_SUCCESS &&
+			reservedSets[i]->insert(vec1, norm, tolerance) == ReturnCode::RC_SUCCESS;
+		if (reservedFits) {
+			reservedSets[i]->getMemoryUsage(reservedUsage);
+			reservedSets[i]->shrinkToFit();
+			reservedSets[i]->getMemoryUsage(shrunkUsage);
+			reservedFits = reservedUsage.points >= 5000 * dim1 * sizeof(double) &&
+				shrunkUsage.points < reservedUsage.points &&
+				shrunkUsage.overhead > 0 &&
+				reservedSets[i]->find(vec1, norm, tolerance, ind) == ReturnCode::RC_SUCCESS;
+		}
+		delete reservedSets[i];
+	}
+	outputTest("reserve",
+		reservedFits,
+		true);
+
+	// ISet::setSpatialOrder, ISet::reorder, the 2x2x2 block at the origin comes first in Z-order
+	ISet* orderedSets[2] = {set11->clone(), ISet::createKDTreeSet(logger)};
+	bool orderedFound = orderedSets[1] != nullptr;
+	for (size_t i = 0; orderedFound && i < set11->getSize(); ++i) {
+		IVector* vec = nullptr;
+		orderedFound = set11->get(vec, i) == ReturnCode::RC_SUCCESS &&
+			orderedSets[1]->insert(vec, norm, tolerance) == ReturnCode::RC_SUCCESS;
+		delete vec;
+	}
+	for (size_t i = 0; orderedFound && i < 2; ++i) {
+		orderedFound = orderedSets[i] != nullptr &&
+			orderedSets[i]->setSpatialOrder(0.5) == ReturnCode::RC_SUCCESS &&
+			orderedSets[i]->getSize() == set11->getSize();
+		for (size_t j = 0; orderedFound && j < 8; ++j) {
+			IVector* vec = nullptr;
+			orderedFound = orderedSets[i]->get(vec, j) == ReturnCode::RC_SUCCESS &&
+				vec->getCoord(0) < 2.0 && vec->getCoord(1) < 2.0 && vec->getCoord(2) < 2.0;
+			delete vec;
+		}
+		// an insert lands right after the points of its cell
+		point[0] = point[1] = point[2] = 0.5;
+		IVector* vec = IVector::createVector(dim1, point, logger);
+		orderedFound = orderedFound &&
+			orderedSets[i]->insert(vec, norm, tolerance) == ReturnCode::RC_SUCCESS &&
+			orderedSets[i]->find(vec, norm, tolerance, ind) == ReturnCode::RC_SUCCESS &&
+			ind == 1 &&
+			orderedSets[i]->find(vec1, norm, tolerance, ind) == set11->find(vec1, norm, tolerance, ind);
+		delete vec;
+	}
+	outputTest("setSpatialOrder",
+		orderedFound,
+		true);
+
+	outputTest("reorder",
+		orderedSets[0] != nullptr &&
+		orderedSets[0]->reorder(-1.0) != ReturnCode::RC_SUCCESS);	// record will be added to logfile
+	delete orderedSets[0];
+	delete orderedSets[1];
+
+	// ISet::createConcurrentSet, every thread inserts a shifted copy of the grid
+	ISet* concurrentSet = ISet::createConcurrentSet(tolerance, logger);
+	assert(concurrentSet != nullptr);
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < 4; ++t) {
+		threads.emplace_back([=]() {
+			double shifted[3];
+			for (size_t i = 0; i < 1000; ++i) {
+				shifted[0] = (double)(i % 10) + 0.01 * (double)t;
+				shifted[1] = (double)(i / 10 % 10);
+				shifted[2] = (double)(i / 100);
+				IVector* vec = IVector::createVector(dim1, shifted, logger);
+				concurrentSet->insert(vec, norm, tolerance);
+				delete vec;
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	// the lexicographically smallest copy, the unshifted one, wins
+	bool concurrentFound = concurrentSet->getSize() == 1000;
+	for (size_t i = 0; concurrentFound && i < 1000; ++i) {
+		IVector* vec = nullptr;
+		size_t concurrentInd = 0;
+		concurrentFound = set11->get(vec, i) == ReturnCode::RC_SUCCESS &&
+			concurrentSet->find(vec, norm, 1e-9, concurrentInd) == ReturnCode::RC_SUCCESS;
+		delete vec;
+	}
+	outputTest("createConcurrentSet",
+		concurrentFound &&
+		concurrentSet->erase(vec1, norm, 1.0) == ReturnCode::RC_SUCCESS &&
+		concurrentSet->getSize() < 1000 &&
+		concurrentSet->setEraseMode(ISet::EraseMode::EM_ORDERED) != ReturnCode::RC_SUCCESS,	// record will be added to logfile
+		true);
+	delete concurrentSet;
+
+	outputTest("createConcurrentSet",
+		ISet::createConcurrentSet(0.0, logger) == nullptr);	// record will be added to logfile
+
+	// const queries from several threads, the first ones build the lazy index and tree
+	ISet* sharedSets[2] = {set11->clone(), ISet::createKDTreeSet(logger)};
+	assert(sharedSets[0] != nullptr && sharedSets[1] != nullptr);
+	sharedSets[0]->setFilter(true);
+	for (size_t i = 0; i < 1000; ++i) {
+		IVector* vec = nullptr;
+		set11->get(vec, i);
+		sharedSets[1]->insert(vec, norm, tolerance);
+		delete vec;
+	}
+	size_t sharedHits[2][4] = {{0, 0, 0, 0}, {0, 0, 0, 0}};
+	for (size_t s = 0; s < 2; ++s) {
+		threads.clear();
+		for (size_t t = 0; t < 4; ++t) {
+			threads.emplace_back([&, s, t]() {
+				for (size_t i = 0; i < 1000; ++i) {
+					IVector* vec = nullptr;
+					size_t sharedInd = 0;
+					if (set11->get(vec, i) == ReturnCode::RC_SUCCESS &&
+						sharedSets[s]->find(vec, norm, tolerance * (double)(1 + t % 2), sharedInd) == ReturnCode::RC_SUCCESS &&
+						sharedInd == i) {
+						++sharedHits[s][t];
+					}
+					delete vec;
+				}
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+	bool sharedFound = true;
+	for (size_t t = 0; t < 4; ++t) {
+		sharedFound = sharedFound && sharedHits[0][t] == 1000 && sharedHits[1][t] == 1000;
+	}
+	outputTest("find (threads)",
+		sharedFound,
+		true);
+	delete sharedSets[0];
+	delete sharedSets[1];
+
+	// ISet::createLSHSet, ISet::getLSHStats
+	ISet::LSHParams lshParams = {8, 4, 4.0, true, 1};
+	ISet* lshSet = ISet::createLSHSet(lshParams, logger);
+	bool lshFound = lshSet != nullptr;
+	for (size_t i = 0; lshFound && i < 1000; ++i) {
+		IVector* vec = nullptr;
+		lshFound = set11->get(vec, i) == ReturnCode::RC_SUCCESS &&
+			lshSet->insert(vec, norm, tolerance) == ReturnCode::RC_SUCCESS;
+		delete vec;
+	}
+	for (size_t i = 0; lshFound && i < 1000; ++i) {
+		IVector* vec = nullptr;
+		size_t lshInd = 0;
+		lshFound = set11->get(vec, i) == ReturnCode::RC_SUCCESS &&
+			lshSet->find(vec, norm, tolerance, lshInd) == ReturnCode::RC_SUCCESS &&
+			lshInd == i;
+		delete vec;
+	}
+	// every insert after the first one misses and is confirmed by a full scan,
+	// a stored point always hashes into its own buckets, so no find misses
+	ISet::LSHStats lshStats = {0, 0};
+	outputTest("createLSHSet",
+		lshFound &&
+		lshSet->getSize() == 1000 &&
+		ISet::getLSHStats(lshSet, lshStats, logger) == ReturnCode::RC_SUCCESS &&
+		lshStats.lookups == 1999 &&
+		lshStats.fullScans == 999,
+		true);
+	delete lshSet;
+
+	// pairs of points closer than the tolerance, narrow buckets split some of them,
+	// erase still removes both points of every pair through the full scan
+	ISet::LSHParams narrowParams = {1, 8, 1.0, true, 1};
+	lshSet = ISet::createLSHSet(narrowParams, logger);
+	assert(lshSet != nullptr);
+	for (size_t i = 0; i < 50; ++i) {
+		double pair[2][3] = {{10.0 * (double)i, 0.0, 0.0}, {10.0 * (double)i + 0.9 * tolerance, 0.0, 0.0}};
+		for (size_t j = 0; j < 2; ++j) {
+			IVector* vec = IVector::createVector(dim1, pair[j], logger);
+			lshSet->insert(vec, norm, 0.0);
+			delete vec;
+		}
+	}
+	bool lshErased = lshSet->getSize() == 100;
+	for (size_t i = 0; lshErased && i < 50; ++i) {
+		double first[3] = {10.0 * (double)i, 0.0, 0.0};
+		IVector* vec = IVector::createVector(dim1, first, logger);
+		lshErased = lshSet->erase(vec, norm, tolerance) == ReturnCode::RC_SUCCESS;
+		delete vec;
+	}
+	outputTest("createLSHSet",
+		lshErased &&
+		lshSet->getSize() == 0);
+	delete lshSet;
+
+	lshParams.tables = 0;
+	outputTest("createLSHSet",
+		ISet::createLSHSet(lshParams, logger) == nullptr &&	// record will be added to logfile
+		ISet::getLSHStats(set11, lshStats, logger) == ReturnCode::RC_INVALID_PARAMS);	// record will be added to logfile
+
+	// ISet::forEach
+	CountingVisitor visitor;
+	visitor.m_dim = dim1;
+	outputTest("forEach",
+		set11->forEach(visitor) == ReturnCode::RC_SUCCESS &&
+		visitor.m_count == 1000 &&
+		std::fabs(visitor.m_sum - 13500.0) < tolerance,
+		true);
+
+	// ISet::getBlock
+	size_t cursor = 0;
+	size_t blockPoints = 0;
+	double const* block = nullptr;
+	size_t blockSize = 0;
+	while (set11->getBlock(cursor, block, blockSize) == ReturnCode::RC_SUCCESS) {
+		blockPoints += blockSize;
+	}
+	outputTest("getBlock",
+		blockPoints == set11->getSize() &&
+		cursor == set11->getSize(),
+		true);
+
+	// ISet::createKDTreeSet
+	ISet* set12 = ISet::createKDTreeSet(logger);
+	outputTest("createKDTreeSet",
+		set12 != nullptr &&
+		set12->getDim() == 0 &&
+		set12->getSize() == 0,
+		true);
+	assert(set12 != nullptr);
+	for (size_t i = 0; i < 1000; ++i) {
+		point[0] = (double)((i * 7) % 10);
+		point[1] = (double)(i / 10 % 10);
+		point[2] = (double)(i / 100);
+		IVector* vec = IVector::createVector(dim1, point, logger);
+		assert(vec != nullptr);
+		set12->insert(vec, norm, tolerance);
+		set12->insert(vec, norm, tolerance);
+		delete vec;
+	}
+	outputTest("createKDTreeSet",
+		set12->getDim() == dim1 &&
+		set12->getSize() == 1000);
+
+	// ISet::findNearest, ISet::findInRadius agree for both implementations
+	std::vector<size_t> inds11, inds12;
+	bool sameNeighbours = true;
+	IVector::Norm norms[3] = {IVector::Norm::NORM_1, IVector::Norm::NORM_2, IVector::Norm::NORM_INF};
+	for (size_t i = 0; i < 30; ++i) {
+		point[0] = 0.37 * (double)i;
+		point[1] = 9.0 - 0.29 * (double)i;
+		point[2] = 0.5 + 0.1 * (double)i;
+		IVector* vec = IVector::createVector(dim1, point, logger);
+		assert(vec != nullptr);
+		IVector::Norm n = norms[i % 3];
+		sameNeighbours = sameNeighbours &&
+			set11->findNearest(vec, n, 5, inds11) == ReturnCode::RC_SUCCESS &&
+			set12->findNearest(vec, n, 5, inds12) == ReturnCode::RC_SUCCESS &&
+			inds11.size() == 5 && inds12.size() == 5;
+		for (size_t j = 0; sameNeighbours && j < 5; ++j) {
+			IVector* near11 = nullptr;
+			IVector* near12 = nullptr;
+			set11->get(near11, inds11[j]);
+			set12->get(near12, inds12[j]);
+			IVector* diff11 = IVector::sub(near11, vec, logger);
+			IVector* diff12 = IVector::sub(near12, vec, logger);
+			sameNeighbours = std::fabs(diff11->norm(n) - diff12->norm(n)) < 1e-9;
+			delete near11;
+			delete near12;
+			delete diff11;
+			delete diff12;
+		}
+		sameNeighbours = sameNeighbours &&
+			set11->findInRadius(vec, n, 1.5, inds11) == ReturnCode::RC_SUCCESS &&
+			set12->findInRadius(vec, n, 1.5, inds12) == ReturnCode::RC_SUCCESS &&
+			inds11.size() == inds12.size();
+		delete vec;
+	}
+	outputTest("findNearest",
+		sameNeighbours,
+		true);
+
+	size_t ind12 = 0;
+	outputTest("findNearest",
+		set12->findNearest(vec4, norm, 1, inds12) != ReturnCode::RC_SUCCESS &&	// record will be added to logfile
+		set12->find(vec1, norm, 1.0, ind12) == ReturnCode::RC_SUCCESS &&
+		set12->erase(vec1, norm, 1.0) == ReturnCode::RC_SUCCESS &&
+		set12->find(vec1, norm, 1.0, ind12) != ReturnCode::RC_SUCCESS &&
+		set12->getSize() < 1000);
+
 	// ISet::clone
 	ISet* set4 = set1->clone();
 	ISet* set5 = set2->clone();
@@ -294,6 +800,60 @@ bool testISet(bool useLogger) {
 	outputTest("union",
 		nullset == nullptr);
 
+	// ISet::eraseAll
+	ISet* set13 = set7 != nullptr ? set7->clone() : nullptr;
+	outputTest("eraseAll",
+		set13 != nullptr &&
+		set13->eraseAll(set2, norm, tolerance) == ReturnCode::RC_SUCCESS &&
+		set13->getSize() == 1 &&
+		set13->find(vec1, norm, tolerance, ind) == ReturnCode::RC_SUCCESS &&
+		set13->eraseAll(set2, norm, tolerance) == ReturnCode::RC_ELEM_NOT_FOUND &&
+		set13->eraseAll(set6, norm, tolerance) != ReturnCode::RC_SUCCESS,	// record will be added to logfile
+		true);
+	delete set13;
+
+	// ISet::setEraseMode, ISet::compact
+	bool erasedRight = true;
+	ISet* sources[2] = {set11, set12};
+	for (size_t i = 0; i < 2; ++i) {
+		ISet* set = sources[i]->clone();
+		assert(set != nullptr);
+		size_t size = set->getSize();
+		IVector* first = nullptr;
+		IVector* last = nullptr;
+		IVector* sixth = nullptr;
+		IVector* erased = nullptr;
+		size_t lastInd = 0;
+		size_t sixthInd = 0;
+		erasedRight = erasedRight &&
+			set->setEraseMode(ISet::EraseMode::EM_UNORDERED) == ReturnCode::RC_SUCCESS &&
+			set->get(first, 0) == ReturnCode::RC_SUCCESS &&
+			set->get(last, size - 1) == ReturnCode::RC_SUCCESS &&
+			set->find(last, norm, tolerance, lastInd) == ReturnCode::RC_SUCCESS &&	// the index is built before the erase
+			set->erase(0) == ReturnCode::RC_SUCCESS &&
+			set->getSize() == size - 1 &&
+			set->find(first, norm, tolerance, lastInd) == ReturnCode::RC_ELEM_NOT_FOUND &&
+			set->find(last, norm, tolerance, lastInd) == ReturnCode::RC_SUCCESS && lastInd == 0 &&
+			set->setEraseMode(ISet::EraseMode::EM_TOMBSTONE) == ReturnCode::RC_SUCCESS &&
+			set->get(sixth, 6) == ReturnCode::RC_SUCCESS &&
+			set->erase(5) == ReturnCode::RC_SUCCESS &&
+			set->getSize() == size - 2 &&
+			set->get(erased, 5) == ReturnCode::RC_ELEM_NOT_FOUND &&
+			set->erase(5) == ReturnCode::RC_ELEM_NOT_FOUND &&
+			set->find(sixth, norm, tolerance, sixthInd) == ReturnCode::RC_SUCCESS && sixthInd == 6;
+		set->compact();
+		erasedRight = erasedRight &&
+			set->getSize() == size - 2 &&
+			set->find(sixth, norm, tolerance, sixthInd) == ReturnCode::RC_SUCCESS && sixthInd == 5;
+		delete first;
+		delete last;
+		delete sixth;
+		delete set;
+	}
+	outputTest("setEraseMode",
+		erasedRight,
+		true);
+
 	// ISet::difference
 	ISet* set8 = ISet::difference(set1, set2, norm, tolerance, logger);
 	outputTest("difference",
@@ -338,6 +898,172 @@ bool testISet(bool useLogger) {
 	outputTest("symmetricDifference",
 		nullset == nullptr);
 
+	// operands without common points, the intersection is empty
+	ISet* set14 = ISet::symmetricDifference(set11, set10, norm, tolerance, logger);
+	outputTest("symmetricDifference",
+		set14 != nullptr &&
+		set14->getSize() == set11->getSize() + set10->getSize());
+	delete set14;
+
+	set14 = ISet::symmetricDifference(set11, set12, norm, tolerance, logger);
+	outputTest("symmetricDifference",
+		set14 != nullptr &&
+		set14->getSize() == set11->getSize() - set12->getSize());
+	delete set14;
+
+	// two points of set2 closer than the tolerance, far from set1: one of them is kept, as by _union
+	double nearPoints[6] = {10.0, 10.0, 10.0, 10.0 + tolerance / 2, 10.0, 10.0};
+	ISet* nearSet = ISet::createSet(dim1, 2, nearPoints, norm, 0.0, logger);
+	assert(nearSet != nullptr);
+	set14 = ISet::symmetricDifference(set1, nearSet, norm, tolerance, logger);
+	ISet* nearUnion = ISet::_union(set1, nearSet, norm, tolerance, logger);
+	outputTest("symmetricDifference",
+		set14 != nullptr && nearUnion != nullptr &&
+		set14->getSize() == set1->getSize() + 1 &&
+		set14->getSize() == nearUnion->getSize());
+	delete set14;
+	delete nearUnion;
+	delete nearSet;
+
+	// ISet::parallelUnion, ISet::parallelDifference, ISet::parallelIntersection
+	ISet* sequential[3] = {
+		ISet::_union(set11, set7, norm, tolerance, logger),
+		ISet::difference(set11, set12, norm, tolerance, logger),
+		ISet::intersection(set11, set12, norm, tolerance, logger)
+	};
+	ISet* parallel[3] = {
+		ISet::parallelUnion(set11, set7, norm, tolerance, 4, logger),
+		ISet::parallelDifference(set11, set12, norm, tolerance, 4, logger),
+		ISet::parallelIntersection(set11, set12, norm, tolerance, 4, logger)
+	};
+	bool sameResults = true;
+	for (size_t i = 0; i < 3; ++i) {
+		sameResults = sameResults &&
+			sequential[i] != nullptr && parallel[i] != nullptr &&
+			sequential[i]->getSize() == parallel[i]->getSize();
+		for (size_t j = 0; sameResults && j < sequential[i]->getSize(); ++j) {
+			IVector* expected = nullptr;
+			IVector* actual = nullptr;
+			sequential[i]->get(expected, j);
+			parallel[i]->get(actual, j);
+			IVector* diff = IVector::sub(expected, actual, logger);
+			sameResults = diff != nullptr && diff->norm(IVector::Norm::NORM_INF) == 0.0;
+			delete expected;
+			delete actual;
+			delete diff;
+		}
+		delete sequential[i];
+		delete parallel[i];
+	}
+	outputTest("parallel",
+		sameResults,
+		true);
+
+	outputTest("parallel",
+		ISet::parallelUnion(set11, set6, norm, tolerance, 0, logger) == nullptr);	// record will be added to logfile
+
+	// points a tenth of the tolerance apart along the first axis, so every slab boundary has many of them
+	// within its halo. half of the points of haloSet2 lie within the tolerance of a point of haloSet1
+	// shifted across the axis both ways, the other half are moved away from haloSet1 and some of them
+	// lie within the tolerance of each other
+	ISet* haloSet1 = ISet::createSet(logger);
+	ISet* haloSet2 = ISet::createSet(logger);
+	assert(haloSet1 != nullptr && haloSet2 != nullptr);
+	for (size_t i = 0; i < 400; ++i) {
+		double haloData[4];
+		haloData[0] = 0.01 * (double)i;
+		haloData[1] = (double)(i % 7);
+		haloData[2] = haloData[0] + (i % 2 == 0 ? 0.05 : -0.05);
+		haloData[3] = haloData[1] + (i % 10 < 5 ? 0.5 : 0.03);
+		IVector* haloVec1 = IVector::createVector(2, haloData, logger);
+		IVector* haloVec2 = IVector::createVector(2, haloData + 2, logger);
+		assert(haloVec1 != nullptr && haloVec2 != nullptr);
+		haloSet1->insert(haloVec1, norm, 0.0);
+		haloSet2->insert(haloVec2, norm, 0.0);
+		delete haloVec1;
+		delete haloVec2;
+	}
+	ISet* haloSequential[3] = {
+		ISet::_union(haloSet1, haloSet2, norm, tolerance, logger),
+		ISet::difference(haloSet1, haloSet2, norm, tolerance, logger),
+		ISet::intersection(haloSet1, haloSet2, norm, tolerance, logger)
+	};
+	size_t haloThreads[3] = {2, 3, 8};
+	bool haloSame = haloSet1->getSize() == 400 && haloSet2->getSize() == 400;
+	for (size_t t = 0; t < 3; ++t) {
+		ISet* haloParallel[3] = {
+			ISet::parallelUnion(haloSet1, haloSet2, norm, tolerance, haloThreads[t], logger),
+			ISet::parallelDifference(haloSet1, haloSet2, norm, tolerance, haloThreads[t], logger),
+			ISet::parallelIntersection(haloSet1, haloSet2, norm, tolerance, haloThreads[t], logger)
+		};
+		for (size_t i = 0; i < 3; ++i) {
+			haloSame = haloSame &&
+				haloSequential[i] != nullptr && haloParallel[i] != nullptr &&
+				haloSequential[i]->getSize() == haloParallel[i]->getSize();
+			for (size_t j = 0; haloSame && j < haloSequential[i]->getSize(); ++j) {
+				IVector* expected = nullptr;
+				IVector* actual = nullptr;
+				haloSequential[i]->get(expected, j);
+				haloParallel[i]->get(actual, j);
+				IVector* diff = IVector::sub(expected, actual, logger);
+				haloSame = diff != nullptr && diff->norm(IVector::Norm::NORM_INF) == 0.0;
+				delete expected;
+				delete actual;
+				delete diff;
+			}
+			delete haloParallel[i];
+		}
+	}
+	// both kinds of matches have to be there for the comparison to mean anything
+	outputTest("parallel (slab halo)",
+		haloSame &&
+		haloSequential[2]->getSize() != 0 &&
+		haloSequential[1]->getSize() != 0 &&
+		haloSequential[0]->getSize() < 800,
+		true);
+	for (size_t i = 0; i < 3; ++i) {
+		delete haloSequential[i];
+	}
+	delete haloSet1;
+	delete haloSet2;
+
+	// ISet::lazyUnion, ISet::lazyDifference, ISet::lazySymmetricDifference, ISet::lazyIntersection
+	ISet* eager[4] = {
+		ISet::_union(set11, set7, norm, tolerance, logger),
+		ISet::difference(set11, set12, norm, tolerance, logger),
+		ISet::symmetricDifference(set11, set12, norm, tolerance, logger),
+		ISet::intersection(set11, set12, norm, tolerance, logger)
+	};
+	ISet::Cursor* lazy[4] = {
+		ISet::lazyUnion(set11, set7, norm, tolerance, logger),
+		ISet::lazyDifference(set11, set12, norm, tolerance, logger),
+		ISet::lazySymmetricDifference(set11, set12, norm, tolerance, logger),
+		ISet::lazyIntersection(set11, set12, norm, tolerance, logger)
+	};
+	bool sameLazy = true;
+	for (size_t i = 0; i < 4; ++i) {
+		sameLazy = sameLazy && sameStream(lazy[i], eager[i]);
+		delete lazy[i];
+	}
+	outputTest("lazy",
+		sameLazy,
+		true);
+
+	// chained stages give the result of the eager operations applied in turn
+	ISet* chained = ISet::difference(eager[3], set7, norm, tolerance, logger);
+	ISet::Cursor* lazyChained = ISet::lazyDifference(ISet::lazyIntersection(set11, set12, norm, tolerance, logger), set7, norm, tolerance, logger);
+	outputTest("lazy",
+		sameStream(lazyChained, chained));
+	delete lazyChained;
+	delete chained;
+	for (size_t i = 0; i < 4; ++i) {
+		delete eager[i];
+	}
+
+	outputTest("lazy",
+		ISet::lazyUnion(set11, set6, norm, tolerance, logger) == nullptr &&	// record will be added to logfile
+		ISet::lazyIntersection(ISet::lazyUnion(set11, set7, norm, tolerance, logger), set6, norm, tolerance, logger) == nullptr);	// record will be added to logfile
+
 	delete set1;
 	delete set2;
 	delete set3;
@@ -348,6 +1074,8 @@ bool testISet(bool useLogger) {
 	delete set8;
 	delete set9;
 	delete set10;
+	delete set11;
+	delete set12;
 
 	delete vec1;
 	delete vec2;
@@ -12,6 +12,9 @@
 #include <cmath>    // fabs (C++11)
 #include <new>		// nothrow
 #include <iostream> // cout
+#include <vector>	// vector
+#include <cstring>	// memcpy
+#include <stdio.h>	// FILE, fopen, fread, fwrite, remove
 
 // static void printVector(IVector const* v) {
 // 	if (v == nullptr)
@@ -171,6 +174,28 @@ bool testIVector(bool useLogger) {
 	outputTest("setCoord",
 		vec5->setCoord(3, 0.0) != ReturnCode::RC_SUCCESS);
 
+	// IVector::setCoords
+	outputTest("setCoords",
+		vec5->setCoords(0, dim1, data3) == ReturnCode::RC_SUCCESS &&
+		IVector::equals(vec3, vec5, norm2, tolerance1, res, logger) == ReturnCode::RC_SUCCESS &&
+        res == true,
+        true);
+
+	outputTest("setCoords",
+		vec5->setCoords(1, dim1, data1) != ReturnCode::RC_SUCCESS &&	// record will be added to logfile
+		vec5->getCoord(1) == data3[1]);
+
+	// IVector::getCoords
+	double coords[2] = {0.0, 0.0};
+	outputTest("getCoords",
+		vec4->getCoords(2, 2, coords) == ReturnCode::RC_SUCCESS &&
+		coords[0] == data4[2] &&
+		coords[1] == data4[3],
+        true);
+
+	outputTest("getCoords",
+		vec4->getCoords(3, 2, coords) != ReturnCode::RC_SUCCESS);	// record will be added to logfile
+
 	// IVector::add
 	IVector* vec6 = IVector::add(vec1, vec2, logger);
 	IVector* vec7 = IVector::createVector(dim1, test_data_add, logger);
@@ -224,6 +249,93 @@ bool testIVector(bool useLogger) {
 	outputTest("mul (IVec * IVec)",
 		std::isnan(IVector::mul(vec1, vec4)));
 
+	// IVector::saveVector
+	char const* vectorFile = "IVector.bin";
+	outputTest("saveVector",
+		IVector::saveVector(vec4, vectorFile, logger) == ReturnCode::RC_SUCCESS,
+		true);
+
+	outputTest("saveVector",
+		IVector::saveVector(nullvec, vectorFile, logger) != ReturnCode::RC_SUCCESS);	// record will be added to logfile
+
+	// IVector::createMappedVector
+	IVector* vec12 = IVector::createMappedVector(vectorFile, IVector::MapMode::MAP_READ_ONLY, logger);
+	outputTest("createMappedVector",
+		vec12 != nullptr &&
+		vec12->getDim() == dim2 &&
+		IVector::equals(vec4, vec12, norm2, tolerance1, res, logger) == ReturnCode::RC_SUCCESS &&
+		res == true &&
+		vec12->setCoord(0, 0.0) != ReturnCode::RC_SUCCESS,	// record will be added to logfile
+		true);
+
+	IVector* vec13 = IVector::createMappedVector(vectorFile, IVector::MapMode::MAP_COPY_ON_WRITE, logger);
+	outputTest("createMappedVector",
+		vec13 != nullptr &&
+		vec13->setCoord(0, 0.0) == ReturnCode::RC_SUCCESS &&
+		vec13->getCoord(0) == 0.0 &&
+		vec12 != nullptr &&
+		vec12->getCoord(0) == data4[0]);
+
+	nullvec = IVector::createMappedVector("IVector.missing", IVector::MapMode::MAP_READ_ONLY, logger);	// record will be added to logfile
+	outputTest("createMappedVector",
+		nullvec == nullptr);
+
+	// the saved file with its first coordinate, right after the 16 byte header, turned into nan
+	char const* nanFile = "IVector.nan.bin";
+	std::vector<char> bytes(16 + dim2 * sizeof(double));
+	FILE* source = fopen(vectorFile, "rb");
+	assert(source != nullptr);
+	size_t bytesRead = fread(bytes.data(), 1, bytes.size(), source);
+	assert(bytesRead == bytes.size());
+	(void)bytesRead;
+	fclose(source);
+	double nanCoord = std::nan("");
+	std::memcpy(bytes.data() + 16, &nanCoord, sizeof(double));
+	FILE* target = fopen(nanFile, "wb");
+	assert(target != nullptr);
+	fwrite(bytes.data(), 1, bytes.size(), target);
+	fclose(target);
+	IVector* nanVec = IVector::createMappedVector(nanFile, IVector::MapMode::MAP_READ_ONLY, logger);
+	double nanCoords[2] = {0.0, 0.0};
+	outputTest("createMappedVector",
+		nanVec != nullptr &&
+		nanVec->getCoords(2, 2, nanCoords) == ReturnCode::RC_SUCCESS &&
+		nanVec->getCoords(0, 2, nanCoords) == ReturnCode::RC_NAN &&	// record will be added to logfile
+		nanVec->clone() == nullptr);	// record will be added to logfile
+	delete nanVec;
+	remove(nanFile);
+
+	// IVector::getAllocStats
+	IVector::AllocStats before, after;
+	IVector::getAllocStats(before);
+	IVector* vec14 = vec1->clone();
+	IVector::getAllocStats(after);
+	outputTest("getAllocStats",
+		vec14 != nullptr &&
+		after.alignedAllocs == before.alignedAllocs + 1 &&
+		after.liveBytes > before.liveBytes,
+		true);
+
+	// IVector::setHugePageThreshold
+	IVector::setHugePageThreshold(1);
+	IVector::getAllocStats(before);
+	IVector* vec15 = vec1->clone();
+	IVector::getAllocStats(after);
+	IVector::setHugePageThreshold(2 * 1024 * 1024);
+	outputTest("setHugePageThreshold",
+		vec15 != nullptr &&
+		IVector::equals(vec1, vec15, norm2, tolerance1, res, logger) == ReturnCode::RC_SUCCESS &&
+		res == true &&
+		after.transparentHugePageAllocs + after.explicitHugePageAllocs + after.hugePageFallbacks ==
+		before.transparentHugePageAllocs + before.explicitHugePageAllocs + before.hugePageFallbacks + 1,
+		true);
+
+	delete vec14;
+	delete vec15;
+	IVector::getAllocStats(after);
+	outputTest("setHugePageThreshold",
+		after.liveBytes < before.liveBytes);
+
 	delete[] data1;
 	delete[] data2;
 	delete[] data3;
@@ -243,6 +355,8 @@ bool testIVector(bool useLogger) {
 	delete vec9;
 	delete vec10;
 	delete vec11;
+	delete vec12;
+	delete vec13;
 
 	if (logger != nullptr) {
 		logger->releaseLogger(client);
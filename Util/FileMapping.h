@@ -0,0 +1,70 @@
+#ifndef FILE_MAPPING_H
+#define FILE_MAPPING_H
+
+#include <cstddef> // size_t
+
+#ifdef __linux__
+	#include <fcntl.h>	  // open
+	#include <unistd.h>	  // close
+	#include <sys/mman.h> // mmap, munmap
+	#include <sys/stat.h> // fstat
+#elif defined(_WIN32) || defined(WIN32)
+	#include <windows.h>
+#endif
+
+// maps the whole file, returns nullptr for missing or empty files
+static void* mapFile(char const* fileName, bool writable, size_t& viewSize) {
+	void* view = nullptr;
+	viewSize = 0;
+#ifdef __linux__
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		// MAP_PRIVATE gives copy-on-write pages, the file itself is never modified
+		view = mmap(nullptr, (size_t)st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view == MAP_FAILED) {
+			view = nullptr;
+		}
+		else {
+			viewSize = (size_t)st.st_size;
+		}
+	}
+	// mapping stays valid after the descriptor is closed
+	close(fd);
+#elif defined(_WIN32) || defined(WIN32)
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+		if (mapping != NULL) {
+			view = MapViewOfFile(mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+			if (view != NULL) {
+				viewSize = (size_t)size.QuadPart;
+			}
+			// view keeps the mapping object alive
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+#endif
+	return view;
+}
+
+static void unmapFile(void* view, size_t viewSize) {
+	if (view == nullptr) {
+		return;
+	}
+#ifdef __linux__
+	munmap(view, viewSize);
+#elif defined(_WIN32) || defined(WIN32)
+	UnmapViewOfFile(view);
+#endif
+}
+
+#endif /* FILE_MAPPING_H */
@@ -14,6 +14,12 @@ public:
 		NORM_INF
 	};
 
+	// read-only mapping rejects setCoord, copy-on-write keeps changes private to the process
+	enum class MapMode {
+		MAP_READ_ONLY,
+		MAP_COPY_ON_WRITE
+	};
+
 	static IVector* createVector(size_t dim, double* data, ILogger* logger = nullptr);
 	static IVector* add(IVector const* addend1, IVector const* addend2, ILogger* logger = nullptr);
 	static IVector* sub(IVector const* minuend, IVector const* subtrahend, ILogger* logger = nullptr);
@@ -21,9 +27,35 @@ public:
 	static double mul(IVector const* multiplier1, IVector const* multiplier2, ILogger* logger = nullptr);
 	static ReturnCode equals(IVector const* v1, IVector const* v2, Norm norm, double tolerance, bool& result, ILogger* logger = nullptr);
 
+	// counters of the storage paths taken by vector buffers since process start
+	struct AllocStats {
+		// 64 byte aligned heap storage
+		size_t alignedAllocs;
+		// anonymous mapping advised for transparent huge pages
+		size_t transparentHugePageAllocs;
+		// explicitly reserved huge pages
+		size_t explicitHugePageAllocs;
+		// huge pages requested, aligned heap storage used instead
+		size_t hugePageFallbacks;
+		// bytes currently held by vector buffers
+		size_t liveBytes;
+	};
+
+	// buffers of at least threshold bytes are backed by huge pages, 0 disables huge pages
+	static void setHugePageThreshold(size_t bytes);
+	static void getAllocStats(AllocStats& stats);
+
+	// binary format: 16 byte header (magic "IVEC", version, dimension) followed by raw coordinates
+	static ReturnCode saveVector(IVector const* vector, char const* fileName, ILogger* logger = nullptr);
+	// only the header is checked on open, getCoords reports RC_NAN for nan coordinates of a damaged file
+	static IVector* createMappedVector(char const* fileName, MapMode mode, ILogger* logger = nullptr);
+
 	virtual IVector* clone()                                const = 0;
 	virtual ReturnCode setCoord(size_t index, double value) const = 0;
 	virtual double getCoord(size_t index)                   const = 0;
+	// copy count coordinates starting at index, the whole range is validated before any write
+	virtual ReturnCode setCoords(size_t index, size_t count, double const* src) const = 0;
+	virtual ReturnCode getCoords(size_t index, size_t count, double* dst)       const = 0;
 	virtual double norm(Norm norm)                          const = 0;
 	virtual size_t getDim()                                 const = 0;
 
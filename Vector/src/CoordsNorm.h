@@ -0,0 +1,37 @@
+#ifndef COORDS_NORM_H
+#define COORDS_NORM_H
+
+#include "../include/IVector.h"
+#include <cstddef> // size_t
+#include <cmath>   // sqrt, fabs (C++11)
+
+// norm of dim coordinates, shared by the heap and the mapped vectors
+static inline double coordsNorm(double const* data, size_t dim, IVector::Norm norm) {
+	double result = 0;
+	switch (norm) {
+	case IVector::Norm::NORM_1:
+		for (size_t i = 0; i < dim; ++i) {
+			result += std::fabs(data[i]);
+		}
+		break;
+	case IVector::Norm::NORM_2:
+		for (size_t i = 0; i < dim; ++i) {
+			result += data[i] * data[i];
+		}
+		result = std::sqrt(result);
+		break;
+	case IVector::Norm::NORM_INF:
+		result = std::fabs(data[0]);
+		for (size_t i = 1; i < dim; ++i) {
+			if (result < std::fabs(data[i]))
+				result = std::fabs(data[i]);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return result;
+}
+
+#endif /* COORDS_NORM_H */
@@ -1,6 +1,8 @@
 #include "../include/IVector.h"
 #include "VectorImpl.cpp"
+#include "MappedVectorImpl.cpp"
 #include <cstring>	 // memcpy
+#include <stdio.h>	 // FILE, fopen, fwrite
 #include <cmath>	 // nan, isnan, fabs (C++11)
 #include <new>		 // nothrow
 #include <assert.h>	 // assert
@@ -72,17 +74,18 @@ IVector* IVector::createVector(size_t dim, double* src, ILogger* logger) {
 		}
 	}
 
-	double* dst = new(std::nothrow) double[dim];
+	Storage storage = Storage::ST_ALIGNED;
+	double* dst = allocateData(dim, storage);
 	if (dst == nullptr) {
 		LOG(logger, ReturnCode::RC_NO_MEM);
 		return nullptr;
 	}
 	std::memcpy(dst, src, dim * sizeof(double));
 
-	IVector* vector = new(std::nothrow) VectorImpl(dim, dst);
+	IVector* vector = new(std::nothrow) VectorImpl(dim, dst, storage);
 	if (vector == nullptr) {
 		LOG(logger, ReturnCode::RC_NO_MEM);
-		delete[] dst;
+		releaseData(dst, dim, storage);
 		return nullptr;
 	}
 
@@ -97,7 +100,8 @@ IVector* IVector::add(IVector const* addend1, IVector const* addend2, ILogger* l
 	}
 
 	size_t dim = addend1->getDim();
-	double* dst = new(std::nothrow) double[dim];
+	Storage storage = Storage::ST_ALIGNED;
+	double* dst = allocateData(dim, storage);
 	if (dst == nullptr) {
 		if (logger != nullptr)
 			logger->log(__FUNCTION__, ReturnCode::RC_NO_MEM);
@@ -108,10 +112,10 @@ IVector* IVector::add(IVector const* addend1, IVector const* addend2, ILogger* l
 		dst[i] = addend1->getCoord(i) + addend2->getCoord(i);
 	}
 
-	IVector* result = new(std::nothrow) VectorImpl(dim, dst);
+	IVector* result = new(std::nothrow) VectorImpl(dim, dst, storage);
 	if (result == nullptr) {
 		LOG(logger, ReturnCode::RC_NO_MEM);
-		delete[] dst;
+		releaseData(dst, dim, storage);
 		return nullptr;
 	}
 
@@ -126,7 +130,8 @@ IVector* IVector::sub(IVector const* minuend, IVector const* subtrahend, ILogger
 	}
 
 	size_t dim = minuend->getDim();
-	double* dst = new(std::nothrow) double[dim];
+	Storage storage = Storage::ST_ALIGNED;
+	double* dst = allocateData(dim, storage);
 	if (dst == nullptr) {
 		LOG(logger, ReturnCode::RC_NO_MEM);
 		return nullptr;
@@ -136,10 +141,10 @@ IVector* IVector::sub(IVector const* minuend, IVector const* subtrahend, ILogger
 		dst[i] = minuend->getCoord(i) - subtrahend->getCoord(i);
 	}
 
-	IVector* result = new(std::nothrow) VectorImpl(dim, dst);
+	IVector* result = new(std::nothrow) VectorImpl(dim, dst, storage);
 	if (result == nullptr) {
 		LOG(logger, ReturnCode::RC_NO_MEM);
-		delete[] dst;
+		releaseData(dst, dim, storage);
 		return nullptr;
 	}
 
@@ -175,7 +180,8 @@ IVector* IVector::mul(IVector const* multiplier, double scale, ILogger* logger)
     }
 
 	size_t dim = multiplier->getDim();
-	double* dst = new(std::nothrow) double[dim];
+	Storage storage = Storage::ST_ALIGNED;
+	double* dst = allocateData(dim, storage);
 	if (dst == nullptr) {
 		LOG(logger, ReturnCode::RC_NO_MEM);
 		return nullptr;
@@ -185,10 +191,10 @@ IVector* IVector::mul(IVector const* multiplier, double scale, ILogger* logger)
 		dst[i] = multiplier->getCoord(i) * scale;
 	}
 
-	IVector* result = new(std::nothrow) VectorImpl(dim, dst);
+	IVector* result = new(std::nothrow) VectorImpl(dim, dst, storage);
 	if (result == nullptr) {
 		LOG(logger, ReturnCode::RC_NO_MEM);
-		delete[] dst;
+		releaseData(dst, dim, storage);
 		return nullptr;
 	}
 
@@ -222,3 +228,71 @@ ReturnCode IVector::equals(IVector const* v1, IVector const* v2, Norm norm, doub
 	diff = nullptr;
 	return ReturnCode::RC_SUCCESS;
 }
+
+void IVector::setHugePageThreshold(size_t bytes) {
+	g_hugePageThreshold = bytes;
+}
+
+void IVector::getAllocStats(AllocStats& stats) {
+	stats.alignedAllocs             = g_alignedAllocs.load();
+	stats.transparentHugePageAllocs = g_transparentHugePageAllocs.load();
+	stats.explicitHugePageAllocs    = g_explicitHugePageAllocs.load();
+	stats.hugePageFallbacks         = g_hugePageFallbacks.load();
+	stats.liveBytes                 = g_liveBytes.load();
+}
+
+ReturnCode IVector::saveVector(IVector const* vector, char const* fileName, ILogger* logger) {
+	ReturnCode rc = checkData(vector);
+	if (rc != ReturnCode::RC_SUCCESS) {
+		LOG(logger, rc);
+		return rc;
+	}
+
+	if (fileName == nullptr) {
+		LOG(logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	FILE* file = fopen(fileName, "wb");
+	if (file == NULL) {
+		LOG(logger, ReturnCode::RC_OPEN_FILE);
+		return ReturnCode::RC_OPEN_FILE;
+	}
+
+	VectorFileHeader header;
+	std::memcpy(header.magic, VECTOR_FILE_MAGIC, sizeof(VECTOR_FILE_MAGIC));
+	header.version = VECTOR_FILE_VERSION;
+	header.dim = vector->getDim();
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	// coordinates are streamed through a small buffer to keep huge vectors out of extra memory
+	size_t const chunk = 512;
+	double buffer[chunk];
+	size_t dim = vector->getDim();
+	for (size_t i = 0; written && i < dim; i += chunk) {
+		size_t count = (dim - i < chunk) ? dim - i : chunk;
+		written = vector->getCoords(i, count, buffer) == ReturnCode::RC_SUCCESS &&
+				  fwrite(buffer, sizeof(double), count, file) == count;
+	}
+
+	if (fclose(file) != 0 || !written) {
+		LOG(logger, ReturnCode::RC_OPEN_FILE);
+		return ReturnCode::RC_OPEN_FILE;
+	}
+
+	return ReturnCode::RC_SUCCESS;
+}
+
+IVector* IVector::createMappedVector(char const* fileName, MapMode mode, ILogger* logger) {
+	if (fileName == nullptr) {
+		LOG(logger, ReturnCode::RC_NULL_PTR);
+		return nullptr;
+	}
+
+	if (mode != MapMode::MAP_READ_ONLY && mode != MapMode::MAP_COPY_ON_WRITE) {
+		LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+		return nullptr;
+	}
+
+	return MappedVectorImpl::createFromFile(fileName, mode, logger);
+}
@@ -0,0 +1,199 @@
+#include "../include/IVector.h"
+#include "../../Util/FileMapping.h"
+#include "CoordsNorm.h"
+
+#include <stdint.h> // uint32_t, uint64_t
+#include <cstring>	// memcmp, memcpy
+#include <cmath>	// nan, isnan
+#include <new>		// nothrow
+
+namespace {
+	/* on-disk layout, coordinates follow the header and stay 16 byte aligned */
+	struct VectorFileHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t dim;
+	};
+
+	static char const VECTOR_FILE_MAGIC[4] = {'I', 'V', 'E', 'C'};
+	static uint32_t const VECTOR_FILE_VERSION = 1;
+
+	/* declaration */
+	class MappedVectorImpl : public IVector {
+	protected:
+		size_t m_dim {0};
+		double* m_data {nullptr};
+		void* m_view {nullptr};
+		size_t m_viewSize {0};
+		bool m_writable {false};
+		ILogger* m_logger {nullptr};
+
+		MappedVectorImpl(size_t dim, void* view, size_t viewSize, bool writable);
+
+	public:
+		static IVector* createFromFile(char const* fileName, MapMode mode, ILogger* logger);
+
+		~MappedVectorImpl() 								  override;
+		IVector* clone() 								const override;
+		size_t getDim() 								const override;
+		ReturnCode setCoord(size_t index, double value) const override;
+		double getCoord(size_t index) 					const override;
+		ReturnCode setCoords(size_t index, size_t count, double const* src) const override;
+		ReturnCode getCoords(size_t index, size_t count, double* dst)       const override;
+		double norm(Norm norm) 							const override;
+	};
+}
+
+/* implementation */
+IVector* MappedVectorImpl::createFromFile(char const* fileName, MapMode mode, ILogger* logger) {
+	bool writable = (mode == MapMode::MAP_COPY_ON_WRITE);
+	size_t viewSize = 0;
+	void* view = mapFile(fileName, writable, viewSize);
+	if (view == nullptr) {
+		LOG(logger, ReturnCode::RC_OPEN_FILE);
+		return nullptr;
+	}
+
+	// only the header is validated, the coordinates are paged in on first access
+	VectorFileHeader const* header = static_cast<VectorFileHeader const*>(view);
+	if (viewSize < sizeof(VectorFileHeader) ||
+		std::memcmp(header->magic, VECTOR_FILE_MAGIC, sizeof(VECTOR_FILE_MAGIC)) != 0 ||
+		header->version != VECTOR_FILE_VERSION) {
+		LOG(logger, ReturnCode::RC_INVALID_PARAMS);
+		unmapFile(view, viewSize);
+		return nullptr;
+	}
+
+	if (header->dim == 0) {
+		LOG(logger, ReturnCode::RC_ZERO_DIM);
+		unmapFile(view, viewSize);
+		return nullptr;
+	}
+
+	if (header->dim > (viewSize - sizeof(VectorFileHeader)) / sizeof(double)) {
+		LOG(logger, ReturnCode::RC_WRONG_DIM);
+		unmapFile(view, viewSize);
+		return nullptr;
+	}
+
+	IVector* vector = new(std::nothrow) MappedVectorImpl((size_t)header->dim, view, viewSize, writable);
+	if (vector == nullptr) {
+		LOG(logger, ReturnCode::RC_NO_MEM);
+		unmapFile(view, viewSize);
+		return nullptr;
+	}
+
+	return vector;
+}
+
+MappedVectorImpl::MappedVectorImpl(size_t dim, void* view, size_t viewSize, bool writable) :
+	m_dim(dim),
+	m_data(reinterpret_cast<double*>(static_cast<char*>(view) + sizeof(VectorFileHeader))),
+	m_view(view),
+	m_viewSize(viewSize),
+	m_writable(writable) {
+	m_logger = ILogger::createLogger(this);
+}
+
+MappedVectorImpl::~MappedVectorImpl() {
+	unmapFile(m_view, m_viewSize);
+	m_view = nullptr;
+	m_data = nullptr;
+	if (m_logger != nullptr) {
+		m_logger->releaseLogger(this);
+	}
+}
+
+// clone is an ordinary heap vector, the mapping is not shared
+IVector* MappedVectorImpl::clone() const {
+	return createVector(m_dim, m_data, m_logger);
+}
+
+size_t MappedVectorImpl::getDim() const {
+	return m_dim;
+}
+
+ReturnCode MappedVectorImpl::setCoord(size_t index, double value) const {
+	if (!m_writable) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	if (index >= m_dim) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	if (std::isnan(value)) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+		return ReturnCode::RC_NAN;
+	}
+
+	m_data[index] = value;
+	return ReturnCode::RC_SUCCESS;
+}
+
+double MappedVectorImpl::getCoord(size_t index) const {
+	if (index >= m_dim) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return std::nan("1");
+	}
+
+	// a damaged file may hold nan, it is reported when the coordinate is read
+	if (std::isnan(m_data[index])) {
+		LOG(m_logger, ReturnCode::RC_NAN);
+	}
+	return m_data[index];
+}
+
+ReturnCode MappedVectorImpl::setCoords(size_t index, size_t count, double const* src) const {
+	if (!m_writable) {
+		LOG(m_logger, ReturnCode::RC_INVALID_PARAMS);
+		return ReturnCode::RC_INVALID_PARAMS;
+	}
+
+	if (src == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (index > m_dim || count > m_dim - index) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		if (std::isnan(src[i])) {
+			LOG(m_logger, ReturnCode::RC_NAN);
+			return ReturnCode::RC_NAN;
+		}
+	}
+
+	std::memcpy(m_data + index, src, count * sizeof(double));
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode MappedVectorImpl::getCoords(size_t index, size_t count, double* dst) const {
+	if (dst == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (index > m_dim || count > m_dim - index) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	std::memcpy(dst, m_data + index, count * sizeof(double));
+	for (size_t i = 0; i < count; ++i) {
+		if (std::isnan(dst[i])) {
+			LOG(m_logger, ReturnCode::RC_NAN);
+			return ReturnCode::RC_NAN;
+		}
+	}
+	return ReturnCode::RC_SUCCESS;
+}
+
+double MappedVectorImpl::norm(Norm norm) const {
+	return coordsNorm(m_data, m_dim, norm);
+}
@@ -1,36 +1,179 @@
 #include "../include/IVector.h"
+#include "CoordsNorm.h"
 
-#include <stdlib.h>
-#include <cmath>	// nan, isnan, sqrt, fabs (C++11)
+#include <stdlib.h> // posix_memalign, free
+#include <cmath>	// nan, isnan
+#include <cstring>	// memcpy
+#include <atomic>	// atomic
+
+#ifdef __linux__
+	#include <sys/mman.h> // mmap, munmap, madvise
+#elif defined(_WIN32) || defined(WIN32)
+	#include <malloc.h>	  // _aligned_malloc, _aligned_free
+	#include <windows.h>  // VirtualAlloc, VirtualFree
+#endif
 
 namespace {
+	/* storage path of a vector buffer, needed to release it properly */
+	enum class Storage {
+		ST_ALIGNED,
+		ST_TRANSPARENT_HUGE_PAGE,
+		ST_EXPLICIT_HUGE_PAGE
+	};
+
 	/* declaration */
 	class VectorImpl : public IVector {
 	protected:
 		size_t m_dim {0};
 		double* m_data {nullptr};
+		Storage m_storage {Storage::ST_ALIGNED};
 		ILogger* m_logger {nullptr};
 
 	public:
-		VectorImpl(size_t dim, double* data);
+		VectorImpl(size_t dim, double* data, Storage storage);
 		~VectorImpl() 										  override;
 		IVector* clone() 								const override;
 		size_t getDim() 								const override;
 		ReturnCode setCoord(size_t index, double value) const override;
 		double getCoord(size_t index) 					const override;
+		ReturnCode setCoords(size_t index, size_t count, double const* src) const override;
+		ReturnCode getCoords(size_t index, size_t count, double* dst)       const override;
 		double norm(Norm norm) 							const override;
 	};
 }
 
+/* allocation */
+static size_t const DATA_ALIGNMENT  = 64;
+static size_t const HUGE_PAGE_SIZE  = 2 * 1024 * 1024;
+
+static std::atomic<size_t> g_hugePageThreshold(HUGE_PAGE_SIZE);
+static std::atomic<size_t> g_alignedAllocs(0);
+static std::atomic<size_t> g_transparentHugePageAllocs(0);
+static std::atomic<size_t> g_explicitHugePageAllocs(0);
+static std::atomic<size_t> g_hugePageFallbacks(0);
+static std::atomic<size_t> g_liveBytes(0);
+
+// huge page backed buffers occupy whole huge pages
+static size_t storageSize(size_t dim, Storage storage) {
+	size_t bytes = dim * sizeof(double);
+	if (storage == Storage::ST_ALIGNED) {
+		return (bytes + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+	}
+	return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+static void* allocateHugePages(size_t size, Storage& storage) {
+#ifdef __linux__
+	void* data = MAP_FAILED;
+	#ifdef MAP_HUGETLB
+	data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (data != MAP_FAILED) {
+		storage = Storage::ST_EXPLICIT_HUGE_PAGE;
+		return data;
+	}
+	#endif
+	// no reserved huge pages, ask the kernel to back the region transparently
+	data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+	#ifdef MADV_HUGEPAGE
+	madvise(data, size, MADV_HUGEPAGE);
+	#endif
+	storage = Storage::ST_TRANSPARENT_HUGE_PAGE;
+	return data;
+#elif defined(_WIN32) || defined(WIN32)
+	// large pages need SeLockMemoryPrivilege, without it the call simply fails
+	SIZE_T largePage = GetLargePageMinimum();
+	if (largePage == 0 || size % largePage != 0) {
+		return nullptr;
+	}
+	void* data = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	if (data != NULL) {
+		storage = Storage::ST_EXPLICIT_HUGE_PAGE;
+	}
+	return data;
+#else
+	return nullptr;
+#endif
+}
+
+static void* allocateAligned(size_t size) {
+#if defined(_WIN32) || defined(WIN32)
+	return _aligned_malloc(size, DATA_ALIGNMENT);
+#else
+	void* data = nullptr;
+	if (posix_memalign(&data, DATA_ALIGNMENT, size) != 0) {
+		return nullptr;
+	}
+	return data;
+#endif
+}
+
+// returns nullptr if there is not enough memory, storage tells how to release the buffer
+static double* allocateData(size_t dim, Storage& storage) {
+	size_t threshold = g_hugePageThreshold.load();
+	void* data = nullptr;
+
+	if (threshold != 0 && dim * sizeof(double) >= threshold) {
+		size_t size = storageSize(dim, Storage::ST_TRANSPARENT_HUGE_PAGE);
+		data = allocateHugePages(size, storage);
+		if (data != nullptr) {
+			if (storage == Storage::ST_EXPLICIT_HUGE_PAGE) {
+				++g_explicitHugePageAllocs;
+			}
+			else {
+				++g_transparentHugePageAllocs;
+			}
+			g_liveBytes += size;
+			return static_cast<double*>(data);
+		}
+		++g_hugePageFallbacks;
+	}
+
+	storage = Storage::ST_ALIGNED;
+	size_t size = storageSize(dim, storage);
+	data = allocateAligned(size);
+	if (data == nullptr) {
+		return nullptr;
+	}
+	++g_alignedAllocs;
+	g_liveBytes += size;
+	return static_cast<double*>(data);
+}
+
+static void releaseData(double* data, size_t dim, Storage storage) {
+	if (data == nullptr) {
+		return;
+	}
+
+	size_t size = storageSize(dim, storage);
+	if (storage == Storage::ST_ALIGNED) {
+#if defined(_WIN32) || defined(WIN32)
+		_aligned_free(data);
+#else
+		free(data);
+#endif
+	}
+	else {
+#ifdef __linux__
+		munmap(data, size);
+#elif defined(_WIN32) || defined(WIN32)
+		VirtualFree(data, 0, MEM_RELEASE);
+#endif
+	}
+	g_liveBytes -= size;
+}
+
 /* implementation */
-VectorImpl::VectorImpl(size_t dim, double* data) :
-	m_dim(dim), m_data(data) {
+VectorImpl::VectorImpl(size_t dim, double* data, Storage storage) :
+	m_dim(dim), m_data(data), m_storage(storage) {
 	m_logger = ILogger::createLogger(this);
 }
 
 VectorImpl::~VectorImpl() {
 	if (m_data != nullptr) {
-		delete[] m_data;
+		releaseData(m_data, m_dim, m_storage);
 		m_data = nullptr;
 	}
 	if(m_logger != nullptr) {
@@ -69,30 +212,43 @@ double VectorImpl::getCoord(size_t index) const {
 	return m_data[index];
 }
 
-double VectorImpl::norm(Norm norm) const {
-	double result = 0;
-	switch (norm) {
-	case Norm::NORM_1:
-		for (size_t i = 0; i < m_dim; ++i) {
-			result += std::fabs(m_data[i]);
-		}
-		break;
-	case Norm::NORM_2:
-		for (size_t i = 0; i < m_dim; ++i) {
-			result += m_data[i] * m_data[i];
-		}
-		result = std::sqrt(result);
-		break;
-	case Norm::NORM_INF:
-		result = std::fabs(m_data[0]);
-		for (size_t i = 1; i < m_dim; ++i) {
-			if (result < std::fabs(m_data[i]))
-				result = std::fabs(m_data[i]);
+ReturnCode VectorImpl::setCoords(size_t index, size_t count, double const* src) const {
+	if (src == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (index > m_dim || count > m_dim - index) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		if (std::isnan(src[i])) {
+			LOG(m_logger, ReturnCode::RC_NAN);
+			return ReturnCode::RC_NAN;
 		}
-		break;
-	default:
-		break;
 	}
 
-	return result;
+	std::memcpy(m_data + index, src, count * sizeof(double));
+	return ReturnCode::RC_SUCCESS;
+}
+
+ReturnCode VectorImpl::getCoords(size_t index, size_t count, double* dst) const {
+	if (dst == nullptr) {
+		LOG(m_logger, ReturnCode::RC_NULL_PTR);
+		return ReturnCode::RC_NULL_PTR;
+	}
+
+	if (index > m_dim || count > m_dim - index) {
+		LOG(m_logger, ReturnCode::RC_OUT_OF_BOUNDS);
+		return ReturnCode::RC_OUT_OF_BOUNDS;
+	}
+
+	std::memcpy(dst, m_data + index, count * sizeof(double));
+	return ReturnCode::RC_SUCCESS;
+}
+
+double VectorImpl::norm(Norm norm) const {
+	return coordsNorm(m_data, m_dim, norm);
 }